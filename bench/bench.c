@@ -0,0 +1,81 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+/* Nearest-rank percentile of sorted `values`. */
+static double percentile(const double *values, int count, double p)
+{
+  int rank = (int)(p / 100 * count + 0.5);
+  if (rank < 1) rank = 1;
+  if (rank > count) rank = count;
+  return values[rank - 1];
+}
+
+int bench_parse_options(int argc, char **argv, BenchOptions *options)
+{
+  int i;
+  for (i = 1; i < argc && argv[i][0] == '-'; i += 2) {
+    if (i + 1 >= argc) return -1;
+    int value = atoi(argv[i + 1]);
+    if (!strcmp(argv[i], "-w") && value >= 0) options->warmup = value;
+    else if (!strcmp(argv[i], "-s") && value > 0) options->samples = value;
+    else if (!strcmp(argv[i], "-n") && value > 0) options->iterations = value;
+    else return -1;
+  }
+  return i;
+}
+
+int bench_run(const char *engine, const char *workload, BenchFunc func,
+              void *ctx, const BenchOptions *options)
+{
+  double *ns_per_call = malloc(options->samples * sizeof(double));
+  double sum = 0;
+  int i, j;
+
+  for (i = 0; i < options->warmup; ++i)
+    if (func(ctx)) goto failed;
+
+  for (i = 0; i < options->samples; ++i) {
+    uint64_t start = now_ns();
+    for (j = 0; j < options->iterations; ++j)
+      if (func(ctx)) goto failed;
+    ns_per_call[i] = (double)(now_ns() - start) / options->iterations;
+    sum += ns_per_call[i];
+  }
+  qsort(ns_per_call, options->samples, sizeof(double), compare_doubles);
+
+  printf("{\"engine\": \"%s\", \"workload\": \"%s\", \"warmup\": %d, "
+         "\"samples\": %d, \"iterations\": %d, \"ns_per_call\": "
+         "{\"min\": %.1f, \"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, "
+         "\"p99\": %.1f, \"max\": %.1f}}\n",
+         engine, workload, options->warmup, options->samples,
+         options->iterations, ns_per_call[0], sum / options->samples,
+         percentile(ns_per_call, options->samples, 50),
+         percentile(ns_per_call, options->samples, 90),
+         percentile(ns_per_call, options->samples, 99),
+         ns_per_call[options->samples - 1]);
+  fflush(stdout);
+  free(ns_per_call);
+  return 0;
+
+failed:
+  fprintf(stderr, "%s: %s failed\n", engine, workload);
+  free(ns_per_call);
+  return 1;
+}
@@ -0,0 +1,30 @@
+/* Shared timing and reporting for the wasm3 and wasm2c benchmark drivers. */
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+
+typedef struct {
+  /* Untimed runs before sampling starts. */
+  int warmup;
+  /* Timed samples; percentiles are taken over these. */
+  int samples;
+  /* Calls per sample, so that short calls are longer than the clock's
+   * resolution. */
+  int iterations;
+} BenchOptions;
+
+/* One call of a workload. Returns nonzero if it failed. */
+typedef int (*BenchFunc)(void *ctx);
+
+/* Parse `-w warmup -s samples -n iterations` from argv into `options`, which
+ * holds the defaults on entry. Returns the index of the first other argument,
+ * or -1 on a usage error. */
+int bench_parse_options(int argc, char **argv, BenchOptions *options);
+
+/* Time `func`, then print one JSON object describing the result on its own
+ * line of stdout. Returns nonzero if any call failed. */
+int bench_run(const char *engine, const char *workload, BenchFunc func,
+              void *ctx, const BenchOptions *options);
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,57 @@
+/* Startup cost of wasm_rt_register_func_type for many distinct signatures,
+ * as when several large modules are linked into one binary.
+ *
+ *   cc -O2 -pthread -I../standalone -o func-types func-types.c \
+ *      ../standalone/wasm-rt-impl.c
+ *   ./func-types [count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "wasm-rt.h"
+
+static double now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Register the signature numbered `n`: eight params whose types are the base-4
+ * digits of `n`, with one result of type `n % 4` or none. Extra varargs are
+ * simply not read by the runtime. */
+static uint32_t register_signature(uint32_t n)
+{
+  wasm_rt_type_t t[9];
+  uint32_t i;
+  for (i = 0; i < 8; ++i)
+    t[i] = (wasm_rt_type_t)((n >> (2 * i)) & 3);
+  t[8] = (wasm_rt_type_t)(n & 3);
+  return wasm_rt_register_func_type(8, (n >> 16) & 1, t[0], t[1], t[2], t[3],
+                                    t[4], t[5], t[6], t[7], t[8]);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t count = argc > 1 ? (uint32_t)atoi(argv[1]) : 10000;
+  uint32_t i;
+  if (count > 131072) count = 131072;
+
+  uint32_t *indices = malloc(count * sizeof(uint32_t));
+
+  double start = now_ms();
+  for (i = 0; i < count; ++i)
+    indices[i] = register_signature(i);
+  double registered = now_ms();
+  for (i = 0; i < count; ++i)
+    if (register_signature(i) != indices[i]) {
+      fprintf(stderr, "signature %u was not interned\n", i);
+      return 1;
+    }
+  double looked_up = now_ms();
+  free(indices);
+
+  printf("{\"signatures\": %u, \"register_ms\": %.3f, \"lookup_ms\": %.3f}\n",
+         count, registered - start, looked_up - registered);
+  return 0;
+}
@@ -0,0 +1,11 @@
+#! /bin/bash
+# Run every workload through both engines and print one JSON array of results.
+# Options (-w warmup -s samples -n iterations) are passed to both drivers.
+
+set -e
+cd "$(dirname "$0")"
+
+{
+  ./wasm3-bench "$@" fib32.wasm add.wasm increment.wasm
+  ./wasm2c-bench "$@"
+} | sed '1s/^/[/; $!s/$/,/; $s/$/]/'
@@ -0,0 +1,67 @@
+/* Cost of the stack exhaustion check on call-heavy code: recursive fib through
+ * the wasm2c-compiled module, built once per strategy.
+ *
+ *   cc -O2 -pthread -I../standalone -o stack-check-counter stack-check.c \
+ *      ../standalone/fib.c ../standalone/wasm-rt-impl.c
+ *   cc -O2 -pthread -I../standalone -DWASM_RT_STACK_GUARD_PAGE=1 \
+ *      -o stack-check-guard stack-check.c \
+ *      ../standalone/fib.c ../standalone/wasm-rt-impl.c
+ *   ./stack-check-counter [n] [repetitions]
+ *   ./stack-check-guard [n] [repetitions]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "wasm-rt-impl.h"
+#include "fib.h"
+
+static instance_t instance;
+
+typedef struct {
+  u32 n;
+  u32 result;
+} FibCall;
+
+static void call_fib(void *arg)
+{
+  FibCall *call = arg;
+  call->result = Z_fibZ_ii(&instance, call->n);
+}
+
+static double now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+  u32 n = argc > 1 ? (u32)atoi(argv[1]) : 30;
+  int repetitions = argc > 2 ? atoi(argv[2]) : 10;
+  int i;
+
+  init();
+  init_instance(&instance);
+
+  wasm_rt_trap_t code = wasm_rt_impl_try();
+  if (code != WASM_RT_TRAP_NONE) {
+    printf("trap %d\n", code);
+    return 1;
+  }
+
+  FibCall call = {n, 0};
+  double best = 0;
+  for (i = 0; i < repetitions; ++i) {
+    double start = now_ms();
+    wasm_rt_call_with_stack(call_fib, &call);
+    double elapsed = now_ms() - start;
+    if (i == 0 || elapsed < best) best = elapsed;
+  }
+
+  printf("{\"strategy\": \"%s\", \"n\": %u, \"result\": %u, \"best_ms\": %.3f}\n",
+         WASM_RT_STACK_GUARD_PAGE ? "guard-page" : "counter", n, call.result,
+         best);
+  free_instance(&instance);
+  return 0;
+}
@@ -0,0 +1,120 @@
+/* The benchmark workloads, run through the wasm2c-compiled modules in
+ * standalone/. Each module is built with its own WASM_RT_MODULE_PREFIX so
+ * they can share one binary; see the Dockerfile's bench target.
+ *
+ *   ./wasm2c-bench [-w warmup] [-s samples] [-n iterations] [fib-n]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "wasm-rt-impl.h"
+#include "instance-pool.h"
+#include "bench.h"
+
+#define WASM_RT_MODULE_PREFIX fib_
+#include "fib.h"
+#undef WASM_RT_MODULE_PREFIX
+#define WASM_RT_MODULE_PREFIX add_
+#include "add.h"
+#undef WASM_RT_MODULE_PREFIX
+#define WASM_RT_MODULE_PREFIX increment_
+#include "increment.h"
+#undef WASM_RT_MODULE_PREFIX
+
+/* Where loadAndIncrement reads from; clear of the allocator's own data. */
+#define LOAD_LOCATION 8
+
+static fib_instance_t fib;
+static add_instance_t add;
+static increment_instance_t increment;
+static u32 fib_n;
+static volatile u32 sink;
+
+static int run_fib(void *ctx)
+{
+  sink = fib_Z_fibZ_ii(&fib, fib_n);
+  return 0;
+}
+
+static int run_add(void *ctx)
+{
+  sink = add_Z_addZ_iii(&add, 20, 30);
+  return 0;
+}
+
+static int run_load_and_increment(void *ctx)
+{
+  sink = increment_Z_loadAndIncrementZ_ii(&increment, LOAD_LOCATION);
+  return 0;
+}
+
+static int run_alloc_release(void *ctx)
+{
+  u32 ptr = increment_Z___allocZ_iii(&increment, 64, 0);
+  increment_Z___releaseZ_vi(&increment,
+                            increment_Z___retainZ_ii(&increment, ptr));
+  return 0;
+}
+
+static void pool_init(void *context, void *instance)
+{
+  increment_init_instance(instance);
+}
+
+static uint64_t pool_reset(void *context, void *instance)
+{
+  return increment_reset_instance(instance);
+}
+
+static void pool_free(void *context, void *instance)
+{
+  increment_free_instance(instance);
+}
+
+/* loadAndIncrement in a fresh instance from a pool, as when isolating each
+ * request. */
+static int run_pooled_instance(void *ctx)
+{
+  increment_instance_t *instance = instance_pool_acquire(ctx);
+  increment_Z_memory(instance)->data[LOAD_LOCATION] = 33;
+  sink = increment_Z_loadAndIncrementZ_ii(instance, LOAD_LOCATION);
+  instance_pool_release(ctx, instance);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  BenchOptions options = {100, 50, 1000};
+  int arg = bench_parse_options(argc, argv, &options);
+  if (arg < 0) {
+    fprintf(stderr, "usage: %s [-w warmup] [-s samples] [-n iterations] "
+                    "[fib-n]\n", argv[0]);
+    return 2;
+  }
+  fib_n = arg < argc ? (u32)atoi(argv[arg]) : 20;
+
+  fib_init();
+  fib_init_instance(&fib);
+  add_init();
+  add_init_instance(&add);
+  increment_init();
+  increment_init_instance(&increment);
+  increment_Z_memory(&increment)->data[LOAD_LOCATION] = 33;
+
+  instance_pool_module_t pool_module = {sizeof(increment_instance_t), NULL,
+                                       pool_init, pool_reset, pool_free};
+  instance_pool_t *pool = instance_pool_create(&pool_module, 1, 1);
+
+  wasm_rt_trap_t code = wasm_rt_impl_try();
+  if (code != WASM_RT_TRAP_NONE) {
+    fprintf(stderr, "trap %d\n", code);
+    return 1;
+  }
+  return bench_run("wasm2c", "fib", run_fib, NULL, &options) ||
+         bench_run("wasm2c", "add", run_add, NULL, &options) ||
+         bench_run("wasm2c", "loadAndIncrement", run_load_and_increment,
+                   NULL, &options) ||
+         bench_run("wasm2c", "alloc_release", run_alloc_release, NULL,
+                   &options) ||
+         bench_run("wasm2c", "pooled_instance", run_pooled_instance, pool,
+                   &options);
+}
@@ -0,0 +1,144 @@
+/* The benchmark workloads, run through the wasm3 interpreter. Links against
+ * the libm3.a built in the Dockerfile's builder stage.
+ *
+ *   ./wasm3-bench [-w warmup] [-s samples] [-n iterations] \
+ *     fib32.wasm add.wasm increment.wasm [fib-n]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wasm3.h"
+#include "bench.h"
+
+/* Must match the wasm2c driver. */
+#define LOAD_LOCATION 8
+#define STACK_SIZE (64 * 1024)
+
+typedef struct {
+  IM3Runtime runtime;
+  uint8_t *bytes;
+} Module;
+
+static IM3Environment env;
+static IM3Function fib, add, load_and_increment, alloc, retain, release;
+static uint32_t fib_n;
+static volatile uint32_t sink;
+
+static int check(M3Result result, const char *what)
+{
+  if (result) fprintf(stderr, "wasm3: %s: %s\n", what, result);
+  return result != m3Err_none;
+}
+
+static int load_module(Module *module, const char *path)
+{
+  FILE *file = fopen(path, "rb");
+  IM3Module parsed;
+  long size;
+
+  if (!file) {
+    perror(path);
+    return 1;
+  }
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  module->bytes = malloc(size);
+  if (fread(module->bytes, 1, size, file) != (size_t)size) {
+    perror(path);
+    fclose(file);
+    return 1;
+  }
+  fclose(file);
+
+  /* One runtime per module, as each has its own memory. */
+  module->runtime = m3_NewRuntime(env, STACK_SIZE, NULL);
+  return check(m3_ParseModule(env, &parsed, module->bytes, size), path) ||
+         check(m3_LoadModule(module->runtime, parsed), path);
+}
+
+static int find(IM3Function *function, Module *module, const char *name)
+{
+  return check(m3_FindFunction(function, module->runtime, name), name);
+}
+
+static int call_u32(IM3Function function, uint32_t *result)
+{
+  return check(m3_GetResultsV(function, result), m3_GetFunctionName(function));
+}
+
+static int run_fib(void *ctx)
+{
+  uint32_t result;
+  if (check(m3_CallV(fib, fib_n), "fib") || call_u32(fib, &result)) return 1;
+  sink = result;
+  return 0;
+}
+
+static int run_add(void *ctx)
+{
+  uint32_t result;
+  if (check(m3_CallV(add, 20, 30), "add") || call_u32(add, &result)) return 1;
+  sink = result;
+  return 0;
+}
+
+static int run_load_and_increment(void *ctx)
+{
+  uint32_t result;
+  if (check(m3_CallV(load_and_increment, LOAD_LOCATION), "loadAndIncrement") ||
+      call_u32(load_and_increment, &result))
+    return 1;
+  sink = result;
+  return 0;
+}
+
+static int run_alloc_release(void *ctx)
+{
+  uint32_t ptr;
+  if (check(m3_CallV(alloc, 64, 0), "__alloc") || call_u32(alloc, &ptr) ||
+      check(m3_CallV(retain, ptr), "__retain") || call_u32(retain, &ptr))
+    return 1;
+  return check(m3_CallV(release, ptr), "__release");
+}
+
+int main(int argc, char **argv)
+{
+  BenchOptions options = {100, 50, 1000};
+  Module fib_module, add_module, increment_module;
+  uint32_t memory_size;
+  uint8_t *memory;
+  int arg = bench_parse_options(argc, argv, &options);
+
+  if (arg < 0 || argc - arg < 3) {
+    fprintf(stderr, "usage: %s [-w warmup] [-s samples] [-n iterations] "
+                    "fib32.wasm add.wasm increment.wasm [fib-n]\n", argv[0]);
+    return 2;
+  }
+  fib_n = argc - arg > 3 ? (uint32_t)atoi(argv[arg + 3]) : 20;
+
+  env = m3_NewEnvironment();
+  if (load_module(&fib_module, argv[arg]) ||
+      load_module(&add_module, argv[arg + 1]) ||
+      load_module(&increment_module, argv[arg + 2]) ||
+      find(&fib, &fib_module, "fib") || find(&add, &add_module, "add") ||
+      find(&load_and_increment, &increment_module, "loadAndIncrement") ||
+      find(&alloc, &increment_module, "__alloc") ||
+      find(&retain, &increment_module, "__retain") ||
+      find(&release, &increment_module, "__release"))
+    return 1;
+
+  memory = m3_GetMemory(increment_module.runtime, &memory_size, 0);
+  if (!memory || memory_size <= LOAD_LOCATION) {
+    fprintf(stderr, "wasm3: increment module has no memory\n");
+    return 1;
+  }
+  memory[LOAD_LOCATION] = 33;
+
+  return bench_run("wasm3", "fib", run_fib, NULL, &options) ||
+         bench_run("wasm3", "add", run_add, NULL, &options) ||
+         bench_run("wasm3", "loadAndIncrement", run_load_and_increment, NULL,
+                   &options) ||
+         bench_run("wasm3", "alloc_release", run_alloc_release, NULL,
+                   &options);
+}
@@ -0,0 +1,53 @@
+#ifndef ADD_H_GENERATED_
+#define ADD_H_GENERATED_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "wasm-rt.h"
+
+#ifndef WASM_RT_MODULE_PREFIX
+#define WASM_RT_MODULE_PREFIX
+#endif
+
+#define WASM_RT_PASTE_(x, y) x ## y
+#define WASM_RT_PASTE(x, y) WASM_RT_PASTE_(x, y)
+#define WASM_RT_ADD_PREFIX(x) WASM_RT_PASTE(WASM_RT_MODULE_PREFIX, x)
+
+/* TODO(binji): only use stdint.h types in header */
+typedef uint8_t u8;
+typedef int8_t s8;
+typedef uint16_t u16;
+typedef int16_t s16;
+typedef uint32_t u32;
+typedef int32_t s32;
+typedef uint64_t u64;
+typedef int64_t s64;
+typedef float f32;
+typedef double f64;
+typedef wasm_rt_v128 v128;
+
+/* The state of one instance of the module. Any number of instances can be
+ * live at once; each owns its own memory and globals. */
+typedef struct WASM_RT_ADD_PREFIX(instance_t) {
+  /* The module has no memory, table or globals. */
+  char unused;
+} WASM_RT_ADD_PREFIX(instance_t);
+
+/* Module-wide initialization; call once before initializing any instance. */
+extern void WASM_RT_ADD_PREFIX(init)(void);
+extern void WASM_RT_ADD_PREFIX(init_instance)(WASM_RT_ADD_PREFIX(instance_t)*);
+/* Return an instance to the state `init_instance` left it in, reusing its
+ * memory. Returns the number of bytes of memory that had to be reset. */
+extern u64 WASM_RT_ADD_PREFIX(reset_instance)(WASM_RT_ADD_PREFIX(instance_t)*);
+extern void WASM_RT_ADD_PREFIX(free_instance)(WASM_RT_ADD_PREFIX(instance_t)*);
+
+/* export: 'add' */
+extern u32 WASM_RT_ADD_PREFIX(Z_addZ_iii)(WASM_RT_ADD_PREFIX(instance_t)*, u32, u32);
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* ADD_H_GENERATED_ */
@@ -0,0 +1,210 @@
+/* Runs an export of a wasm module from its wasm2c build, cached as a shared
+ * object by the Dockerfile's aot stage, the way `wasm3 --func` would run it
+ * from the .wasm:
+ *
+ *   ./aot-run <module.so> <function> [i32 args...]
+ *
+ * The shared object holds wasm2c's output for the module, but not the
+ * runtime, which it takes from this executable. wasm2c exports each function
+ * as a pointer that the module's init() fills in. Only exports with i32
+ * parameters and at most one i32 result can be called. Exits with
+ * AOT_RUN_UNAVAILABLE if the module cannot be loaded or has no such export,
+ * so that start.sh can fall back to wasm3 without having run anything.
+ *
+ * WASI imports come from wasi.c, with the working directory preopened under
+ * its own absolute path. The Dockerfile renames a module's imports to
+ * aot_import_*, which are defined here, so that they don't collide with the
+ * wasi.c functions of the same name, which take a `wasi_t*` first.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <dlfcn.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "wasi.h"
+#include "wasm-rt-impl.h"
+
+#define AOT_RUN_UNAVAILABLE 127
+#define AOT_RUN_MAX_ARGS 4
+
+extern char** environ;
+
+/* The WASI state of the one instance, for the imports below. */
+static wasi_t g_wasi;
+
+/* Each import as the function pointer a module built by wasm2c expects,
+ * calling the wasi.c function with `g_wasi`. */
+#define AOT_PARAMS_ii (uint32_t a)
+#define AOT_ARGS_ii a
+#define AOT_PARAMS_vi (uint32_t a)
+#define AOT_ARGS_vi a
+#define AOT_PARAMS_iii (uint32_t a, uint32_t b)
+#define AOT_ARGS_iii a, b
+#define AOT_PARAMS_iiii (uint32_t a, uint32_t b, uint32_t c)
+#define AOT_ARGS_iiii a, b, c
+#define AOT_PARAMS_iiiii (uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+#define AOT_ARGS_iiiii a, b, c, d
+#define AOT_PARAMS_iiji (uint32_t a, uint64_t b, uint32_t c)
+#define AOT_ARGS_iiji a, b, c
+#define AOT_PARAMS_iijii (uint32_t a, uint64_t b, uint32_t c, uint32_t d)
+#define AOT_ARGS_iijii a, b, c, d
+#define AOT_PARAMS_iiiiiijjii                                             \
+  (uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t e, uint64_t f, \
+   uint64_t g, uint32_t h, uint32_t i)
+#define AOT_ARGS_iiiiiijjii a, b, c, d, e, f, g, h, i
+
+#define AOT_IMPORT(module, name, sig)                                    \
+  static uint32_t aot_##module##_##name AOT_PARAMS_##sig {               \
+    return Z_##module##Z_##name##Z_##sig(&g_wasi, AOT_ARGS_##sig);       \
+  }                                                                      \
+  uint32_t (*aot_import_Z_##module##Z_##name##Z_##sig)                   \
+      AOT_PARAMS_##sig = aot_##module##_##name;
+
+#define AOT_VOID_IMPORT(module, name, sig)                               \
+  static void aot_##module##_##name AOT_PARAMS_##sig {                   \
+    Z_##module##Z_##name##Z_##sig(&g_wasi, AOT_ARGS_##sig);              \
+  }                                                                      \
+  void (*aot_import_Z_##module##Z_##name##Z_##sig)                       \
+      AOT_PARAMS_##sig = aot_##module##_##name;
+
+#define AOT_WASI_IMPORTS(module)                        \
+  AOT_IMPORT(module, args_get, iii)                     \
+  AOT_IMPORT(module, args_sizes_get, iii)               \
+  AOT_IMPORT(module, environ_get, iii)                  \
+  AOT_IMPORT(module, environ_sizes_get, iii)            \
+  AOT_IMPORT(module, clock_time_get, iiji)              \
+  AOT_IMPORT(module, fd_close, ii)                      \
+  AOT_IMPORT(module, fd_fdstat_get, iii)                \
+  AOT_IMPORT(module, fd_prestat_get, iii)               \
+  AOT_IMPORT(module, fd_prestat_dir_name, iiii)         \
+  AOT_IMPORT(module, fd_read, iiiii)                    \
+  AOT_IMPORT(module, fd_seek, iijii)                    \
+  AOT_IMPORT(module, fd_write, iiiii)                   \
+  AOT_IMPORT(module, path_open, iiiiiijjii)             \
+  AOT_IMPORT(module, random_get, iii)                   \
+  AOT_VOID_IMPORT(module, proc_exit, vi)
+
+AOT_WASI_IMPORTS(wasi_snapshot_preview1)
+AOT_WASI_IMPORTS(wasi_unstable)
+AOT_IMPORT(wasi_ext, fd_map, iijii)
+
+/* Set up `g_wasi` for the module's memory, which WASI modules export, as the
+ * ABI requires. The module sees the path of its build as its only argument.
+ * Returns -1 on failure. */
+static int init_wasi(wasm_rt_memory_t* memory, char* module_path) {
+  char cwd[PATH_MAX];
+
+  if (wasi_init(&g_wasi, memory, 1, &module_path, environ) < 0) {
+    perror("wasi_init");
+    return -1;
+  }
+  if (!getcwd(cwd, sizeof(cwd)) || wasi_preopen(&g_wasi, cwd, cwd) < 0) {
+    perror("preopen");
+    return -1;
+  }
+  if (wasi_buffer_output(&g_wasi, 64 * 1024, 60 * 1024) < 0) {
+    perror("wasi_buffer_output");
+    return -1;
+  }
+  return 0;
+}
+
+typedef uint32_t (*call0_t)(void);
+typedef uint32_t (*call1_t)(uint32_t);
+typedef uint32_t (*call2_t)(uint32_t, uint32_t);
+typedef uint32_t (*call3_t)(uint32_t, uint32_t, uint32_t);
+typedef uint32_t (*call4_t)(uint32_t, uint32_t, uint32_t, uint32_t);
+
+/* Look up the pointer to the export `name` taking `arg_count` i32s, under
+ * the name wasm2c gives it for either an i32 result or none: a result letter,
+ * then one per parameter or `v` for none, as in Z_fibZ_ii or Z_startZ_vv. */
+static void** find_export(void* module, const char* name, int arg_count,
+                          int* has_result) {
+  char symbol[256];
+  int length = snprintf(symbol, sizeof(symbol) - AOT_RUN_MAX_ARGS,
+                        "Z_%sZ_i", name);
+  void** func;
+
+  if (length < 0 || length >= (int)sizeof(symbol) - AOT_RUN_MAX_ARGS)
+    return NULL;
+  if (arg_count == 0) {
+    symbol[length] = 'v';
+    symbol[length + 1] = '\0';
+  } else {
+    memset(symbol + length, 'i', arg_count);
+    symbol[length + arg_count] = '\0';
+  }
+  if ((func = dlsym(module, symbol)) != NULL) {
+    *has_result = 1;
+    return func;
+  }
+  symbol[length - 1] = 'v';
+  *has_result = 0;
+  return dlsym(module, symbol);
+}
+
+static uint32_t call_export(void* func, const uint32_t* args, int arg_count) {
+  switch (arg_count) {
+    case 0: return ((call0_t)func)();
+    case 1: return ((call1_t)func)(args[0]);
+    case 2: return ((call2_t)func)(args[0], args[1]);
+    case 3: return ((call3_t)func)(args[0], args[1], args[2]);
+    default: return ((call4_t)func)(args[0], args[1], args[2], args[3]);
+  }
+}
+
+int main(int argc, char** argv) {
+  uint32_t args[AOT_RUN_MAX_ARGS];
+  int arg_count = argc - 3;
+  int has_result, i;
+
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <module.so> <function> [i32 args...]\n",
+            argv[0]);
+    return AOT_RUN_UNAVAILABLE;
+  }
+  if (arg_count > AOT_RUN_MAX_ARGS) {
+    fprintf(stderr, "%s: at most %d arguments\n", argv[2], AOT_RUN_MAX_ARGS);
+    return AOT_RUN_UNAVAILABLE;
+  }
+  for (i = 0; i < arg_count; ++i)
+    args[i] = (uint32_t)strtoul(argv[3 + i], NULL, 0);
+
+  /* RTLD_NOW resolves the runtime up front, so a module built against a
+   * different one fails here rather than halfway through the call. */
+  void* module = dlopen(argv[1], RTLD_NOW | RTLD_LOCAL);
+  if (!module) {
+    fprintf(stderr, "%s\n", dlerror());
+    return AOT_RUN_UNAVAILABLE;
+  }
+  void (*init)(void) = (void (*)(void))dlsym(module, "init");
+  void** func = find_export(module, argv[2], arg_count, &has_result);
+  if (!init || !func) {
+    fprintf(stderr, "%s: no export %s taking %d i32 arguments\n", argv[1],
+            argv[2], arg_count);
+    return AOT_RUN_UNAVAILABLE;
+  }
+  init();
+  wasm_rt_memory_t** memory = dlsym(module, "Z_memory");
+  if (memory && init_wasi(*memory, argv[1]) < 0)
+    return 1;
+
+  wasm_rt_trap_t code = wasm_rt_impl_try();
+  if (code != WASM_RT_TRAP_NONE) {
+    if (memory)
+      wasi_free(&g_wasi);
+    if (code == WASM_RT_TRAP_EXIT)
+      return (int)g_wasi.exit_code;
+    fprintf(stderr, "trap %d in %s\n", code, argv[2]);
+    return 1;
+  }
+  uint32_t result = call_export(*func, args, arg_count);
+  if (memory)
+    wasi_free(&g_wasi);
+  /* Printed the way wasm3 prints it. */
+  if (has_result)
+    printf("Result: %u\n", result);
+  return 0;
+}
@@ -0,0 +1,222 @@
+#include "as-rt.h"
+
+#include <string.h>
+
+/* Every object is preceded by a header whose last field is the size of its
+ * contents in bytes. */
+#define AS_RT_HEADER_SIZE 16
+#define AS_RT_SIZE_OFFSET 4
+
+/* The TLSF root holds a bitmap of the first-level classes with free blocks,
+ * one of the second-level classes for each first-level class, the head of
+ * each second-level free list, and the address of the tail block that ends
+ * the heap. The heap itself starts after the root and is a run of blocks,
+ * each a header followed by its contents. */
+#define TLSF_SL_COUNT 16
+#define TLSF_SL_MAP_OFFSET 4
+#define TLSF_HEADS_OFFSET 96
+#define TLSF_TAIL_OFFSET 1568
+#define TLSF_ROOT_SIZE 1572
+/* The first word of a block header is its size, with flags in the low bits.
+ * Free blocks link to the next on their list after the header. */
+#define TLSF_FREE 1u
+#define TLSF_SIZE_MASK (~3u)
+#define TLSF_NEXT_OFFSET 20
+
+uint8_t* as_rt_alloc(const as_rt_module_t* module,
+                     uint32_t size,
+                     uint32_t id,
+                     uint32_t* ptr) {
+  *ptr = module->retain(module->instance,
+                        module->alloc(module->instance, size, id));
+  return module->memory->data + *ptr;
+}
+
+void as_rt_release(const as_rt_module_t* module, uint32_t ptr) {
+  module->release(module->instance, ptr);
+}
+
+uint8_t* as_rt_view(const as_rt_module_t* module,
+                    uint32_t ptr,
+                    uint32_t* size) {
+  wasm_rt_memory_t* memory = module->memory;
+  uint32_t object_size;
+
+  if (ptr < AS_RT_HEADER_SIZE || ptr > memory->size) {
+    return NULL;
+  }
+  memcpy(&object_size, memory->data + ptr - AS_RT_SIZE_OFFSET,
+         sizeof(object_size));
+  if (object_size > memory->size - ptr) {
+    return NULL;
+  }
+  if (size) {
+    *size = object_size;
+  }
+  return memory->data + ptr;
+}
+
+/* Decode the code point starting at `*str`, advancing past it. Returns
+ * UINT32_MAX on malformed input. */
+static uint32_t decode_utf8(const unsigned char** str,
+                            const unsigned char* end) {
+  const unsigned char* s = *str;
+  uint32_t c = *s++, min;
+  int continuation;
+
+  if (c < 0x80) {
+    *str = s;
+    return c;
+  } else if ((c & 0xe0) == 0xc0) {
+    c &= 0x1f, continuation = 1, min = 0x80;
+  } else if ((c & 0xf0) == 0xe0) {
+    c &= 0x0f, continuation = 2, min = 0x800;
+  } else if ((c & 0xf8) == 0xf0) {
+    c &= 0x07, continuation = 3, min = 0x10000;
+  } else {
+    return UINT32_MAX;
+  }
+  if (end - s < continuation) {
+    return UINT32_MAX;
+  }
+  while (continuation--) {
+    if ((*s & 0xc0) != 0x80) {
+      return UINT32_MAX;
+    }
+    c = c << 6 | (*s++ & 0x3f);
+  }
+  if (c < min || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff)) {
+    return UINT32_MAX;
+  }
+  *str = s;
+  return c;
+}
+
+uint32_t as_rt_new_string(const as_rt_module_t* module,
+                          const char* str,
+                          size_t length) {
+  const unsigned char* s = (const unsigned char*)str;
+  const unsigned char* end = s + length;
+  size_t units = 0;
+  uint32_t ptr;
+  uint8_t* data;
+
+  /* Size the String first, so its contents can be written in place. */
+  while (s < end) {
+    uint32_t c = decode_utf8(&s, end);
+    if (c == UINT32_MAX) {
+      return 0;
+    }
+    units += c >= 0x10000 ? 2 : 1;
+  }
+  if (units > UINT32_MAX / 2) {
+    return 0;
+  }
+
+  data = as_rt_alloc(module, (uint32_t)units * 2, AS_RT_STRING_ID, &ptr);
+  for (s = (const unsigned char*)str; s < end;) {
+    uint32_t c = decode_utf8(&s, end);
+    uint16_t unit[2];
+    int count = 1;
+    if (c >= 0x10000) {
+      c -= 0x10000;
+      unit[0] = 0xd800 | (c >> 10);
+      unit[1] = 0xdc00 | (c & 0x3ff);
+      count = 2;
+    } else {
+      unit[0] = c;
+    }
+    /* Linear memory is little-endian, as is every host wasm2c supports. */
+    memcpy(data, unit, count * sizeof(uint16_t));
+    data += count * sizeof(uint16_t);
+  }
+  return ptr;
+}
+
+/* Load the u32 at `address`. Returns -1 if it is outside linear memory. */
+static int load_u32(const wasm_rt_memory_t* memory,
+                    uint64_t address,
+                    uint32_t* value) {
+  if (address + sizeof(*value) > memory->size) {
+    return -1;
+  }
+  memcpy(value, memory->data + address, sizeof(*value));
+  return 0;
+}
+
+int as_rt_heap_stats(const as_rt_module_t* module,
+                     uint32_t root,
+                     as_rt_heap_stats_t* stats) {
+  const wasm_rt_memory_t* memory = module->memory;
+  uint64_t block = ((uint64_t)root + TLSF_ROOT_SIZE + AS_RT_HEADER_SIZE - 1) &
+                   ~(uint64_t)(AS_RT_HEADER_SIZE - 1);
+  uint32_t tail, info, fl_map, fl;
+  uint64_t steps = 0, max_steps;
+
+  memset(stats, 0, sizeof(*stats));
+  if (load_u32(memory, (uint64_t)root + TLSF_TAIL_OFFSET, &tail) < 0 ||
+      tail < block) {
+    return -1;
+  }
+  stats->heap_size = tail + AS_RT_HEADER_SIZE - (uint32_t)block;
+
+  while (block < tail) {
+    uint32_t size;
+    if (load_u32(memory, block, &info) < 0) {
+      return -1;
+    }
+    size = info & TLSF_SIZE_MASK;
+    if (info & TLSF_FREE) {
+      ++stats->free_blocks;
+      stats->free_bytes += size;
+      if (size > stats->largest_free_block) {
+        stats->largest_free_block = size;
+      }
+    } else {
+      ++stats->used_blocks;
+      stats->used_bytes += size;
+    }
+    block += AS_RT_HEADER_SIZE + (uint64_t)size;
+  }
+  if (block != tail) {
+    return -1;
+  }
+
+  /* A damaged list could loop; no heap has more blocks than this. */
+  max_steps = stats->heap_size / AS_RT_HEADER_SIZE;
+  if (load_u32(memory, root, &fl_map) < 0) {
+    return -1;
+  }
+  for (fl = 0; fl < AS_RT_TLSF_FL_COUNT; ++fl) {
+    uint32_t sl_map, sl;
+    if (!(fl_map & (1u << fl))) {
+      continue;
+    }
+    if (load_u32(memory, (uint64_t)root + TLSF_SL_MAP_OFFSET + fl * 4,
+                 &sl_map) < 0) {
+      return -1;
+    }
+    for (sl = 0; sl < TLSF_SL_COUNT; ++sl) {
+      uint32_t free_block;
+      if (!(sl_map & (1u << sl))) {
+        continue;
+      }
+      if (load_u32(memory,
+                   (uint64_t)root + TLSF_HEADS_OFFSET +
+                       (fl * TLSF_SL_COUNT + sl) * 4,
+                   &free_block) < 0) {
+        return -1;
+      }
+      while (free_block) {
+        if (++steps > max_steps || load_u32(memory, free_block, &info) < 0 ||
+            load_u32(memory, (uint64_t)free_block + TLSF_NEXT_OFFSET,
+                     &free_block) < 0) {
+          return -1;
+        }
+        ++stats->free_list_blocks[fl];
+        stats->free_list_bytes[fl] += info & TLSF_SIZE_MASK;
+      }
+    }
+  }
+  return 0;
+}
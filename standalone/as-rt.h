@@ -0,0 +1,97 @@
+/* Host side of the AssemblyScript runtime: passing buffers in and out of a
+ * module's linear memory through its exported `__alloc`, `__retain` and
+ * `__release`, without an intermediate copy.
+ *
+ * The functions here call into the module, so they must be called inside a
+ * `wasm_rt_impl_try` like any other export, and they trap the same way.
+ */
+#ifndef AS_RT_H_
+#define AS_RT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wasm-rt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Class ids of the AssemblyScript built-ins, for `as_rt_alloc`. */
+#define AS_RT_ARRAY_BUFFER_ID 0
+#define AS_RT_STRING_ID 1
+
+/** The exports of one instance that the host API needs. Modules differ in
+ * their instance type, so they are reached through thin wrappers; see
+ * `increment-main.c`. */
+typedef struct {
+  void* instance;
+  wasm_rt_memory_t* memory;
+  uint32_t (*alloc)(void* instance, uint32_t size, uint32_t id);
+  uint32_t (*retain)(void* instance, uint32_t ptr);
+  void (*release)(void* instance, uint32_t ptr);
+} as_rt_module_t;
+
+/** Allocate a `size` byte object of class `id` and retain it, so it stays
+ * live until `as_rt_release`. Its address in linear memory is stored in
+ * `ptr`, and a host pointer to its contents is returned for the caller to
+ * write into directly.
+ *
+ * The returned pointer, like any from `as_rt_view`, is only valid until the
+ * module next runs: growing linear memory may move it. Keep `ptr` instead and
+ * call `as_rt_view` again. */
+uint8_t* as_rt_alloc(const as_rt_module_t*,
+                     uint32_t size,
+                     uint32_t id,
+                     uint32_t* ptr);
+
+/** Release an object returned by `as_rt_alloc`, or one the module handed
+ * back retained. */
+void as_rt_release(const as_rt_module_t*, uint32_t ptr);
+
+/** Host pointer to the contents of the object at `ptr`, with its size in
+ * bytes stored in `size` when it is not NULL. Returns NULL if `ptr` is not an
+ * object inside linear memory. */
+uint8_t* as_rt_view(const as_rt_module_t*, uint32_t ptr, uint32_t* size);
+
+/** Allocate a retained String holding `length` bytes of UTF-8 `str`, which is
+ * converted to the UTF-16 that AssemblyScript uses. Returns its address, or 0
+ * if `str` is not valid UTF-8. */
+uint32_t as_rt_new_string(const as_rt_module_t*, const char* str, size_t length);
+
+/** Number of first-level size classes of the TLSF allocator. Class 0 holds
+ * blocks under 256 bytes, and class `n > 0` those from `2^(n+7)` bytes up to
+ * twice that. */
+#define AS_RT_TLSF_FL_COUNT 23
+
+/** The state of a module's TLSF heap; see `as_rt_heap_stats`. Sizes are of
+ * block contents, without their 16 byte headers. */
+typedef struct {
+  /** Bytes from the first block to the end of the heap, headers included. */
+  uint32_t heap_size;
+  uint32_t used_blocks, used_bytes;
+  uint32_t free_blocks, free_bytes;
+  uint32_t largest_free_block;
+  /** Blocks and bytes on the free lists of each first-level class. */
+  uint32_t free_list_blocks[AS_RT_TLSF_FL_COUNT];
+  uint32_t free_list_bytes[AS_RT_TLSF_FL_COUNT];
+} as_rt_heap_stats_t;
+
+/** Walk the TLSF heap of a module, without calling into it, and fill
+ * `stats`. `root` is the address of the allocator's root structure: the
+ * module's `__heap_base` rounded up to 16 bytes, which is 48 for
+ * increment.wasm. Returns 0, or -1 if the allocator has not set the heap up
+ * yet or its structure is inconsistent.
+ *
+ * Fragmentation is then `1 - largest_free_block / free_bytes`: how much of
+ * the free memory a single allocation cannot use. Call this only between calls
+ * into the module, from the thread that owns the instance. */
+int as_rt_heap_stats(const as_rt_module_t*,
+                     uint32_t root,
+                     as_rt_heap_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AS_RT_H_ */
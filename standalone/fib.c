@@ -0,0 +1,264 @@
+#include <math.h>
+#include <string.h>
+
+#include "fib.h"
+#define UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define LIKELY(x) __builtin_expect(!!(x), 1)
+
+#define TRAP(x) (wasm_rt_trap(WASM_RT_TRAP_##x), 0)
+
+#if WASM_RT_PROFILE
+#define PROFILE_STRINGIFY_(x) #x
+#define PROFILE_STRINGIFY(x) PROFILE_STRINGIFY_(x)
+#define PROFILE_ENTER                                                  \
+  static wasm_rt_profile_func_t profile_func = {                       \
+      PROFILE_STRINGIFY(WASM_RT_MODULE_PREFIX), __func__, 0};          \
+  wasm_rt_profile_enter(&profile_func)
+#define PROFILE_EXIT wasm_rt_profile_exit()
+#else
+#define PROFILE_ENTER
+#define PROFILE_EXIT
+#endif
+
+#if WASM_RT_FUEL
+#define FUEL_CHECK \
+  if (UNLIKELY(--wasm_rt_fuel < 0)) wasm_rt_fuel_exhausted()
+#else
+#define FUEL_CHECK
+#endif
+
+#if WASM_RT_STACK_GUARD_PAGE
+#define FUNC_PROLOGUE FUEL_CHECK; PROFILE_ENTER
+#define FUNC_EPILOGUE PROFILE_EXIT
+#else
+#define FUNC_PROLOGUE                                            \
+  FUEL_CHECK;                                                    \
+  PROFILE_ENTER;                                                 \
+  if (++wasm_rt_call_stack_depth > WASM_RT_MAX_CALL_STACK_DEPTH) \
+    TRAP(EXHAUSTION)
+
+#define FUNC_EPILOGUE PROFILE_EXIT; --wasm_rt_call_stack_depth
+#endif
+
+#define UNREACHABLE TRAP(UNREACHABLE)
+
+#if WASM_RT_DISPATCH_TABLES
+#define CALL_INDIRECT(table, t, ft, x, ...)                       \
+  (LIKELY((((x) & ~table.mask) |                                  \
+           (table.func_types[(x) & table.mask] ^ func_types[ft])) \
+          == 0)                                                   \
+       ? ((t)table.funcs[(x) & table.mask])(__VA_ARGS__)          \
+       : TRAP(CALL_INDIRECT))
+#else
+#define CALL_INDIRECT(table, t, ft, x, ...)          \
+  (LIKELY((x) < table.size && table.data[x].func &&  \
+          table.data[x].func_type == func_types[ft]) \
+       ? ((t)table.data[x].func)(__VA_ARGS__)        \
+       : TRAP(CALL_INDIRECT))
+#endif
+
+#if WASM_RT_MEMCHECK_SIGNAL_HANDLER
+#define MEMCHECK(mem, a, t)
+#else
+#define MEMCHECK(mem, a, t)  \
+  if (UNLIKELY((a) + sizeof(t) > mem->size)) TRAP(OOB)
+#endif
+
+#define DEFINE_LOAD(name, t1, t2, t3)              \
+  static inline t3 name(wasm_rt_memory_t* mem, u64 addr) {   \
+    MEMCHECK(mem, addr, t1);                       \
+    t1 result;                                     \
+    memcpy(&result, &mem->data[addr], sizeof(t1)); \
+    return (t3)(t2)result;                         \
+  }
+
+#define DEFINE_STORE(name, t1, t2)                           \
+  static inline void name(wasm_rt_memory_t* mem, u64 addr, t2 value) { \
+    MEMCHECK(mem, addr, t1);                                 \
+    t1 wrapped = (t1)value;                                  \
+    memcpy(&mem->data[addr], &wrapped, sizeof(t1));          \
+  }
+
+DEFINE_LOAD(i32_load, u32, u32, u32);
+DEFINE_LOAD(i64_load, u64, u64, u64);
+DEFINE_LOAD(f32_load, f32, f32, f32);
+DEFINE_LOAD(f64_load, f64, f64, f64);
+DEFINE_LOAD(i32_load8_s, s8, s32, u32);
+DEFINE_LOAD(i64_load8_s, s8, s64, u64);
+DEFINE_LOAD(i32_load8_u, u8, u32, u32);
+DEFINE_LOAD(i64_load8_u, u8, u64, u64);
+DEFINE_LOAD(i32_load16_s, s16, s32, u32);
+DEFINE_LOAD(i64_load16_s, s16, s64, u64);
+DEFINE_LOAD(i32_load16_u, u16, u32, u32);
+DEFINE_LOAD(i64_load16_u, u16, u64, u64);
+DEFINE_LOAD(i64_load32_s, s32, s64, u64);
+DEFINE_LOAD(i64_load32_u, u32, u64, u64);
+DEFINE_LOAD(v128_load, v128, v128, v128);
+DEFINE_STORE(i32_store, u32, u32);
+DEFINE_STORE(i64_store, u64, u64);
+DEFINE_STORE(f32_store, f32, f32);
+DEFINE_STORE(f64_store, f64, f64);
+DEFINE_STORE(i32_store8, u8, u32);
+DEFINE_STORE(i32_store16, u16, u32);
+DEFINE_STORE(i64_store8, u8, u64);
+DEFINE_STORE(i64_store16, u16, u64);
+DEFINE_STORE(i64_store32, u32, u64);
+DEFINE_STORE(v128_store, v128, v128);
+
+#define I32_CLZ(x) ((x) ? __builtin_clz(x) : 32)
+#define I64_CLZ(x) ((x) ? __builtin_clzll(x) : 64)
+#define I32_CTZ(x) ((x) ? __builtin_ctz(x) : 32)
+#define I64_CTZ(x) ((x) ? __builtin_ctzll(x) : 64)
+#define I32_POPCNT(x) (__builtin_popcount(x))
+#define I64_POPCNT(x) (__builtin_popcountll(x))
+
+#define DIV_S(ut, min, x, y)                                 \
+   ((UNLIKELY((y) == 0)) ?                TRAP(DIV_BY_ZERO)  \
+  : (UNLIKELY((x) == min && (y) == -1)) ? TRAP(INT_OVERFLOW) \
+  : (ut)((x) / (y)))
+
+#define REM_S(ut, min, x, y)                                \
+   ((UNLIKELY((y) == 0)) ?                TRAP(DIV_BY_ZERO) \
+  : (UNLIKELY((x) == min && (y) == -1)) ? 0                 \
+  : (ut)((x) % (y)))
+
+#define I32_DIV_S(x, y) DIV_S(u32, INT32_MIN, (s32)x, (s32)y)
+#define I64_DIV_S(x, y) DIV_S(u64, INT64_MIN, (s64)x, (s64)y)
+#define I32_REM_S(x, y) REM_S(u32, INT32_MIN, (s32)x, (s32)y)
+#define I64_REM_S(x, y) REM_S(u64, INT64_MIN, (s64)x, (s64)y)
+
+#define DIVREM_U(op, x, y) \
+  ((UNLIKELY((y) == 0)) ? TRAP(DIV_BY_ZERO) : ((x) op (y)))
+
+#define DIV_U(x, y) DIVREM_U(/, x, y)
+#define REM_U(x, y) DIVREM_U(%, x, y)
+
+#define ROTL(x, y, mask) \
+  (((x) << ((y) & (mask))) | ((x) >> (((mask) - (y) + 1) & (mask))))
+#define ROTR(x, y, mask) \
+  (((x) >> ((y) & (mask))) | ((x) << (((mask) - (y) + 1) & (mask))))
+
+#define I32_ROTL(x, y) ROTL(x, y, 31)
+#define I64_ROTL(x, y) ROTL(x, y, 63)
+#define I32_ROTR(x, y) ROTR(x, y, 31)
+#define I64_ROTR(x, y) ROTR(x, y, 63)
+
+#define FMIN(x, y)                                          \
+   ((UNLIKELY((x) != (x))) ? NAN                            \
+  : (UNLIKELY((y) != (y))) ? NAN                            \
+  : (UNLIKELY((x) == 0 && (y) == 0)) ? (signbit(x) ? x : y) \
+  : (x < y) ? x : y)
+
+#define FMAX(x, y)                                          \
+   ((UNLIKELY((x) != (x))) ? NAN                            \
+  : (UNLIKELY((y) != (y))) ? NAN                            \
+  : (UNLIKELY((x) == 0 && (y) == 0)) ? (signbit(x) ? y : x) \
+  : (x > y) ? x : y)
+
+#define TRUNC_S(ut, st, ft, min, max, maxop, x)                             \
+   ((UNLIKELY((x) != (x))) ? TRAP(INVALID_CONVERSION)                       \
+  : (UNLIKELY((x) < (ft)(min) || (x) maxop (ft)(max))) ? TRAP(INT_OVERFLOW) \
+  : (ut)(st)(x))
+
+#define I32_TRUNC_S_F32(x) TRUNC_S(u32, s32, f32, INT32_MIN, INT32_MAX, >=, x)
+#define I64_TRUNC_S_F32(x) TRUNC_S(u64, s64, f32, INT64_MIN, INT64_MAX, >=, x)
+#define I32_TRUNC_S_F64(x) TRUNC_S(u32, s32, f64, INT32_MIN, INT32_MAX, >,  x)
+#define I64_TRUNC_S_F64(x) TRUNC_S(u64, s64, f64, INT64_MIN, INT64_MAX, >=, x)
+
+#define TRUNC_U(ut, ft, max, maxop, x)                                    \
+   ((UNLIKELY((x) != (x))) ? TRAP(INVALID_CONVERSION)                     \
+  : (UNLIKELY((x) <= (ft)-1 || (x) maxop (ft)(max))) ? TRAP(INT_OVERFLOW) \
+  : (ut)(x))
+
+#define I32_TRUNC_U_F32(x) TRUNC_U(u32, f32, UINT32_MAX, >=, x)
+#define I64_TRUNC_U_F32(x) TRUNC_U(u64, f32, UINT64_MAX, >=, x)
+#define I32_TRUNC_U_F64(x) TRUNC_U(u32, f64, UINT32_MAX, >,  x)
+#define I64_TRUNC_U_F64(x) TRUNC_U(u64, f64, UINT64_MAX, >=, x)
+
+#define DEFINE_REINTERPRET(name, t1, t2)  \
+  static inline t2 name(t1 x) {           \
+    t2 result;                            \
+    memcpy(&result, &x, sizeof(result));  \
+    return result;                        \
+  }
+
+DEFINE_REINTERPRET(f32_reinterpret_i32, u32, f32)
+DEFINE_REINTERPRET(i32_reinterpret_f32, f32, u32)
+DEFINE_REINTERPRET(f64_reinterpret_i64, u64, f64)
+DEFINE_REINTERPRET(i64_reinterpret_f64, f64, u64)
+
+
+#if WASM_RT_STATIC_FUNC_TYPES
+/* Canonical func type IDs; see WASM_RT_STATIC_FUNC_TYPES in wasm-rt.h. Only
+ * read by call_indirect, which a module need not have. */
+__attribute__((unused)) static const u32 func_types[1] = {
+  0x3a50694fu, /* (i32) -> (i32) */
+};
+#else
+static u32 func_types[1];
+
+static void init_func_types(void) {
+  func_types[0] = wasm_rt_register_func_type(1, 1, WASM_RT_I32, WASM_RT_I32);
+}
+#endif
+
+static u32 fib(WASM_RT_ADD_PREFIX(instance_t)*, u32);
+
+static void init_globals(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+}
+
+static u32 fib(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0) {
+  FUNC_PROLOGUE;
+  u32 i0, i1, i2;
+  i0 = p0;
+  i1 = 2u;
+  i0 = i0 < i1;
+  if (i0) {
+    i0 = p0;
+    goto Bfunc;
+  }
+  i0 = p0;
+  i1 = 2u;
+  i0 -= i1;
+  i0 = fib(instance, i0);
+  i1 = p0;
+  i2 = 1u;
+  i1 -= i2;
+  i1 = fib(instance, i1);
+  i0 += i1;
+  Bfunc:;
+  FUNC_EPILOGUE;
+  return i0;
+}
+
+static void init_memory(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+}
+
+static void init_table(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  uint32_t offset;
+}
+
+/* export: 'fib' */
+u32 WASM_RT_ADD_PREFIX(Z_fibZ_ii)(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0) {
+  return fib(instance, p0);
+}
+
+void WASM_RT_ADD_PREFIX(init)(void) {
+#if !WASM_RT_STATIC_FUNC_TYPES
+  init_func_types();
+#endif
+}
+
+void WASM_RT_ADD_PREFIX(init_instance)(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  init_globals(instance);
+  init_memory(instance);
+  init_table(instance);
+}
+
+u64 WASM_RT_ADD_PREFIX(reset_instance)(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  init_globals(instance);
+  return 0;
+}
+
+void WASM_RT_ADD_PREFIX(free_instance)(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+}
@@ -0,0 +1,151 @@
+#include "fiber-loop.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#define FIBER_LOOP_MAX_EVENTS 64
+
+typedef struct Task {
+  wasm_rt_fiber_t* fiber;
+  void (*done)(void* arg, wasm_rt_trap_t trap);
+  void* arg;
+  /* Events that woke the task from `fiber_loop_wait_fd`. */
+  uint32_t events;
+  /* Next task in the run queue. */
+  struct Task* next;
+} Task;
+
+struct fiber_loop_t {
+  int epoll_fd;
+  /* Tasks ready to run, in the order they became ready. */
+  Task* head;
+  Task* tail;
+  /* The task running, if any. */
+  Task* current;
+  /* Tasks not done yet, whether ready, running or waiting. */
+  uint32_t task_count;
+};
+
+static void push_ready(fiber_loop_t* loop, Task* task) {
+  task->next = NULL;
+  if (loop->tail) {
+    loop->tail->next = task;
+  } else {
+    loop->head = task;
+  }
+  loop->tail = task;
+}
+
+static Task* pop_ready(fiber_loop_t* loop) {
+  Task* task = loop->head;
+  if (task) {
+    loop->head = task->next;
+    if (!loop->head) {
+      loop->tail = NULL;
+    }
+  }
+  return task;
+}
+
+fiber_loop_t* fiber_loop_create(void) {
+  fiber_loop_t* loop = calloc(1, sizeof(fiber_loop_t));
+  if (loop == NULL) {
+    return NULL;
+  }
+  loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (loop->epoll_fd < 0) {
+    free(loop);
+    return NULL;
+  }
+  return loop;
+}
+
+int fiber_loop_spawn(fiber_loop_t* loop,
+                     void (*func)(void* arg),
+                     void (*done)(void* arg, wasm_rt_trap_t trap),
+                     void* arg) {
+  Task* task = calloc(1, sizeof(Task));
+  if (task == NULL || (task->fiber = wasm_rt_fiber_new(func, arg)) == NULL) {
+    free(task);
+    return -1;
+  }
+  task->done = done;
+  task->arg = arg;
+  ++loop->task_count;
+  push_ready(loop, task);
+  return 0;
+}
+
+int fiber_loop_wait_fd(fiber_loop_t* loop, int fd, uint32_t events) {
+  Task* task = loop->current;
+  struct epoll_event event;
+
+  event.events = events | EPOLLONESHOT;
+  event.data.ptr = task;
+  if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+    return -1;
+  }
+  wasm_rt_fiber_suspend();
+  epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+  return task->events;
+}
+
+void fiber_loop_yield(fiber_loop_t* loop) {
+  if (loop->current == NULL) {
+    return;
+  }
+  push_ready(loop, loop->current);
+  wasm_rt_fiber_suspend();
+}
+
+int fiber_loop_run(fiber_loop_t* loop) {
+  struct epoll_event events[FIBER_LOOP_MAX_EVENTS];
+
+  while (loop->task_count > 0) {
+    Task* task;
+    int i, count;
+
+    while ((task = pop_ready(loop)) != NULL) {
+      loop->current = task;
+      if (wasm_rt_fiber_resume(task->fiber) == WASM_RT_FIBER_DONE) {
+        --loop->task_count;
+        if (task->done) {
+          task->done(task->arg, wasm_rt_fiber_trap(task->fiber));
+        }
+        wasm_rt_fiber_free(task->fiber);
+        free(task);
+      }
+      loop->current = NULL;
+    }
+    if (loop->task_count == 0) {
+      break;
+    }
+
+    /* Everything left is waiting for a descriptor. */
+    count = epoll_wait(loop->epoll_fd, events, FIBER_LOOP_MAX_EVENTS, -1);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("epoll_wait");
+      return -1;
+    }
+    for (i = 0; i < count; ++i) {
+      task = events[i].data.ptr;
+      task->events = events[i].events;
+      push_ready(loop, task);
+    }
+  }
+  return 0;
+}
+
+void fiber_loop_destroy(fiber_loop_t* loop) {
+  if (loop == NULL) {
+    return;
+  }
+  close(loop->epoll_fd);
+  free(loop);
+}
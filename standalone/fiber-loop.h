@@ -0,0 +1,61 @@
+/* An epoll event loop that runs calls into wasm on fibers, so that one thread
+ * can keep many of them in flight while each waits for I/O.
+ *
+ * A host function called from wasm on one of the loop's fibers waits with
+ * `fiber_loop_wait_fd` instead of blocking: its fiber is suspended, the loop
+ * runs other fibers meanwhile, and resumes it once the descriptor is ready.
+ * Needs the runtime built with WASM_RT_FIBERS. A loop belongs to the thread
+ * that created it.
+ */
+#ifndef FIBER_LOOP_H_
+#define FIBER_LOOP_H_
+
+#include <stdint.h>
+
+#include "wasm-rt.h"
+
+#if !WASM_RT_FIBERS
+#error "fiber-loop needs WASM_RT_FIBERS"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct fiber_loop_t fiber_loop_t;
+
+/** Create a loop. Returns NULL if the epoll instance cannot be created. */
+fiber_loop_t* fiber_loop_create(void);
+
+/** Start `func(arg)` on a new fiber of the loop. It first runs from
+ * `fiber_loop_run`; when it returns or traps, `done(arg, trap)` is called
+ * there, with the trap or `WASM_RT_TRAP_NONE`. Returns -1 if the fiber cannot
+ * be created. */
+int fiber_loop_spawn(fiber_loop_t*,
+                     void (*func)(void* arg),
+                     void (*done)(void* arg, wasm_rt_trap_t trap),
+                     void* arg);
+
+/** From a fiber of the loop: suspend it until `fd` is ready for `events`
+ * (EPOLLIN, EPOLLOUT, ...). `fd` must not be waited on by another fiber at
+ * the same time. Returns the events that occurred, or -1 with errno set if
+ * `fd` cannot be waited on. */
+int fiber_loop_wait_fd(fiber_loop_t*, int fd, uint32_t events);
+
+/** From a fiber of the loop: let the other ready fibers run, then continue.
+ * A fuel handler can call this to share the thread fairly between fibers
+ * that compute for long. Does nothing outside of the loop's fibers. */
+void fiber_loop_yield(fiber_loop_t*);
+
+/** Run the loop's fibers until all of them are done. Returns 0, or -1 if
+ * waiting for events failed. */
+int fiber_loop_run(fiber_loop_t*);
+
+/** Free a loop whose fibers are all done. */
+void fiber_loop_destroy(fiber_loop_t*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FIBER_LOOP_H_ */
@@ -1,28 +1,184 @@
-/* Adapted from https://github.com/WebAssembly/wabt/blob/master/wasm2c/examples/fac/main.c */
+/* Adapted from https://github.com/WebAssembly/wabt/blob/master/wasm2c/examples/fac/main.c
+ *
+ *   ./increment <value> [location]
+ *   ./increment --batch [file]
+ *
+ * Without a location, the value is passed in a buffer allocated by the
+ * module. The batch form reads whitespace separated "value location" pairs
+ * from file (or stdin) and prints one result per line, all against a single
+ * instance. A pair that fails is reported on stderr with its line number and
+ * gets an empty output line; the exit status is 1 if any pair failed.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include "wasm-rt.h"
+#include <string.h>
+#include "wasm-rt-impl.h"
+#include "as-rt.h"
 #include "increment.h"
 
-int main(int argc, char **argv)
+#define BATCH_BUFFER_SIZE (64 * 1024)
+
+/* Reads the next unsigned decimal from `in`, counting the newlines before it
+ * in `line`. Returns 1 on success, 0 at end of input and -1 on malformed
+ * input. */
+static int read_u32(FILE *in, u32 *out, unsigned long *line)
 {
-  
-  /* Make sure there is at least 2 command-line arguments. */
-  if (argc < 3) return 1;
-  /* the target value to increment */
-  u32 value = atoi(argv[1]);
-  /* where to store in wasm linear memory */
-  u32 location = atoi(argv[2]);
+  int c;
+  u64 value = 0;
 
-  /* Initialize the module */
-  init();
+  do {
+    c = getc_unlocked(in);
+    if (c == '\n') ++*line;
+  } while (isspace(c));
+  if (c == EOF) return 0;
+  if (!isdigit(c)) return -1;
+  for (; isdigit(c); c = getc_unlocked(in)) {
+    value = value * 10 + (c - '0');
+    if (value > UINT32_MAX) return -1;
+  }
+  if (c != EOF && !isspace(c)) return -1;
+  /* Leave a newline ending the number to be counted by the next call, so
+   * that `line` is the number's own line. */
+  if (c == '\n') ungetc(c, in);
+  *out = (u32)value;
+  return 1;
+}
 
-  Z_memory->data[location] = value;
+static u32 module_alloc(void *instance, u32 size, u32 id)
+{
+  return Z___allocZ_iii(instance, size, id);
+}
 
- u32 result = Z_loadAndIncrementZ_ii(location);
- /* Print the result. */
-  printf("%u\n", result);
+static u32 module_retain(void *instance, u32 ptr)
+{
+  return Z___retainZ_ii(instance, ptr);
+}
 
+static void module_release(void *instance, u32 ptr)
+{
+  Z___releaseZ_vi(instance, ptr);
+}
 
+/* Store `value` at `location` and run loadAndIncrement on it. Returns 0 and
+ * sets `result` on success, or prints why the call failed, after the input
+ * `line` it came from if not 0, and returns 1. */
+static int increment(instance_t *instance, u32 value, u32 location,
+                     unsigned long line, u32 *result)
+{
+  wasm_rt_memory_t *memory = Z_memory(instance);
+  if (location > memory->size - sizeof(value)) {
+    if (line) fprintf(stderr, "line %lu: ", line);
+    fprintf(stderr, "location %u is outside of memory (%u bytes)\n",
+            location, memory->size);
+    return 1;
+  }
+  /* Linear memory is little-endian, like the hosts wasm2c supports. */
+  memcpy(memory->data + location, &value, sizeof(value));
+
+  wasm_rt_trap_t code = wasm_rt_impl_try();
+  if (code != WASM_RT_TRAP_NONE) {
+    if (line) fprintf(stderr, "line %lu: ", line);
+    fprintf(stderr, "trap %d at location %u\n", code, location);
+    return 1;
+  }
+  *result = Z_loadAndIncrementZ_ii(instance, location);
+  return 0;
+}
+
+/* Like `increment`, but in a buffer the module allocates for `value`. */
+static int increment_in_buffer(instance_t *instance, u32 value, u32 *result)
+{
+  as_rt_module_t module = {instance, Z_memory(instance), module_alloc,
+                           module_retain, module_release};
+  u32 ptr;
+
+  wasm_rt_trap_t code = wasm_rt_impl_try();
+  if (code != WASM_RT_TRAP_NONE) {
+    fprintf(stderr, "trap %d\n", code);
+    return 1;
+  }
+  memcpy(as_rt_alloc(&module, sizeof(value), AS_RT_ARRAY_BUFFER_ID, &ptr),
+         &value, sizeof(value));
+  *result = Z_loadAndIncrementZ_ii(instance, ptr);
+  as_rt_release(&module, ptr);
   return 0;
-}
\ No newline at end of file
+}
+
+static int run_batch(instance_t *instance, FILE *in)
+{
+  static char out_buffer[BATCH_BUFFER_SIZE];
+  u32 value, location, result;
+  unsigned long line = 1, failed = 0;
+  int status;
+
+  /* Flushed only when full or at exit, not per result. */
+  setvbuf(stdout, out_buffer, _IOFBF, sizeof(out_buffer));
+  setvbuf(in, NULL, _IOFBF, BATCH_BUFFER_SIZE);
+
+  while ((status = read_u32(in, &value, &line)) > 0) {
+    unsigned long pair_line = line;
+    if (read_u32(in, &location, &line) <= 0) {
+      status = -1;
+      break;
+    }
+    if (increment(instance, value, location, pair_line, &result)) {
+      /* Keep the output at one line per pair. */
+      ++failed;
+      putchar('\n');
+      continue;
+    }
+    printf("%u\n", result);
+  }
+  if (status < 0) {
+    fprintf(stderr, "line %lu: malformed input\n", line);
+    return 1;
+  }
+  if (failed) fprintf(stderr, "%lu pairs failed\n", failed);
+  return fflush(stdout) != 0 || ferror(in) || failed != 0;
+}
+
+int main(int argc, char **argv)
+{
+  int batch = argc >= 2 && strcmp(argv[1], "--batch") == 0;
+  FILE *in = stdin;
+  u32 result;
+  int status;
+
+  /* Make sure there is at least 1 command-line argument. */
+  if (argc < 2) return 1;
+  if (batch && argc >= 3 && strcmp(argv[2], "-") != 0) {
+    in = fopen(argv[2], "r");
+    if (!in) {
+      perror(argv[2]);
+      return 1;
+    }
+  }
+
+  /* Initialize the module, then one instance of it */
+  init();
+  instance_t instance;
+  init_instance(&instance);
+
+  if (batch) {
+    status = run_batch(&instance, in);
+  } else if (argc < 3) {
+    /* the target value to increment */
+    status = increment_in_buffer(&instance, strtoul(argv[1], NULL, 10),
+                                 &result);
+    if (!status) printf("%u\n", result);
+  } else {
+    /* the target value to increment, and where to store it in wasm linear
+     * memory */
+    status = increment(&instance, strtoul(argv[1], NULL, 10),
+                       strtoul(argv[2], NULL, 10), 0, &result);
+    /* Print the result. */
+    if (!status) printf("%u\n", result);
+  }
+
+  free_instance(&instance);
+  if (in != stdin) fclose(in);
+
+  return status;
+}
@@ -0,0 +1,457 @@
+/* Serves calls into the increment module over a Unix domain socket, keeping
+ * one warm instance per worker thread.
+ *
+ *   ./increment-server <socket path> [workers] [stats seconds]
+ *
+ * Every frame, in either direction, is a native-endian u32 byte length
+ * followed by that many bytes. A request body is
+ *
+ *   u8 name length, name, u8 argument count, u32 arguments...
+ *
+ * and a response body is
+ *
+ *   u8 status, u32 value
+ *
+ * where value is the export's result (0 if it has none) for SERVER_OK, the
+ * trap code for SERVER_TRAP, and 0 otherwise. Requests on one connection are
+ * answered in order, so clients may pipeline them. A request that traps
+ * resets its worker's instance, since the trap may have left its memory half
+ * written; whatever earlier requests left in it, such as objects from
+ * __alloc, is gone after that.
+ *
+ * Each worker owns an epoll set and an instance; the listening socket is in
+ * every set with EPOLLEXCLUSIVE, and a connection stays with the worker that
+ * accepted it, so instances are never shared between threads.
+ *
+ * Given a stats interval, each worker prints a line of key=value pairs about
+ * its instance's linear memory and heap to stdout that often, between
+ * requests.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "wasm-rt-impl.h"
+#include "as-rt.h"
+#include "increment.h"
+
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE (1u << 28)
+#endif
+
+#define SERVER_MAX_EVENTS 64
+#define SERVER_MAX_FRAME 256
+#define SERVER_MAX_ARGS 4
+#define SERVER_BUFFER_SIZE 4096
+#define SERVER_RESPONSE_SIZE (sizeof(u32) + 1 + sizeof(u32))
+/* Fuel for each request when built with WASM_RT_FUEL; a request that uses
+ * it up fails with WASM_RT_TRAP_FUEL instead of stalling its worker. */
+#define SERVER_REQUEST_FUEL 10000000
+/* Where increment.wasm's allocator keeps its TLSF root. */
+#define SERVER_HEAP_ROOT 48
+
+typedef enum {
+  SERVER_OK,
+  SERVER_TRAP,
+  SERVER_UNKNOWN_EXPORT,
+  SERVER_BAD_ARGUMENTS,
+} ServerStatus;
+
+typedef struct {
+  const char* name;
+  u32 arg_count;
+  u32 (*call)(instance_t*, const u32* args);
+} Export;
+
+typedef struct {
+  int fd;
+  /* The epoll events the connection is registered for. */
+  uint32_t events;
+  size_t in_size;
+  size_t out_size;
+  char in[SERVER_BUFFER_SIZE];
+  char out[SERVER_BUFFER_SIZE];
+} Connection;
+
+typedef struct {
+  pthread_t thread;
+  long index;
+  int epoll_fd;
+  instance_t instance;
+} Worker;
+
+static int g_listen_fd;
+/* Milliseconds between stats lines, or -1 for none. */
+static int g_stats_interval_ms = -1;
+
+static u32 call_load_and_increment(instance_t* instance, const u32* args) {
+  return Z_loadAndIncrementZ_ii(instance, args[0]);
+}
+
+static u32 call_alloc(instance_t* instance, const u32* args) {
+  return Z___allocZ_iii(instance, args[0], args[1]);
+}
+
+static u32 call_retain(instance_t* instance, const u32* args) {
+  return Z___retainZ_ii(instance, args[0]);
+}
+
+static u32 call_release(instance_t* instance, const u32* args) {
+  Z___releaseZ_vi(instance, args[0]);
+  return 0;
+}
+
+static u32 call_collect(instance_t* instance, const u32* args) {
+  (void)args;
+  Z___collectZ_vv(instance);
+  return 0;
+}
+
+static const Export g_exports[] = {
+    {"loadAndIncrement", 1, call_load_and_increment},
+    {"__alloc", 2, call_alloc},
+    {"__retain", 1, call_retain},
+    {"__release", 1, call_release},
+    {"__collect", 0, call_collect},
+};
+
+static const Export* find_export(const char* name, size_t length) {
+  size_t i;
+  for (i = 0; i < sizeof(g_exports) / sizeof(g_exports[0]); ++i) {
+    if (strlen(g_exports[i].name) == length &&
+        memcmp(g_exports[i].name, name, length) == 0) {
+      return &g_exports[i];
+    }
+  }
+  return NULL;
+}
+
+/* Run the request in `body` against `instance`, setting `value` as described
+ * at the top of the file. */
+static ServerStatus handle_request(instance_t* instance,
+                                   const unsigned char* body,
+                                   u32 size,
+                                   u32* value) {
+  u32 args[SERVER_MAX_ARGS];
+  const Export* export;
+  u32 name_length, arg_count;
+
+  *value = 0;
+  if (size < 1 || (name_length = body[0]) + 2 > size) {
+    return SERVER_BAD_ARGUMENTS;
+  }
+  export = find_export((const char*)body + 1, name_length);
+  if (!export) {
+    return SERVER_UNKNOWN_EXPORT;
+  }
+  arg_count = body[1 + name_length];
+  if (arg_count != export->arg_count ||
+      size != 2 + name_length + arg_count * sizeof(u32)) {
+    return SERVER_BAD_ARGUMENTS;
+  }
+  memcpy(args, body + 2 + name_length, arg_count * sizeof(u32));
+
+#if WASM_RT_FUEL
+  wasm_rt_fuel = SERVER_REQUEST_FUEL;
+#endif
+  wasm_rt_trap_t code = wasm_rt_impl_try();
+  if (code != WASM_RT_TRAP_NONE) {
+    /* So that the next request, maybe another client's, starts clean. */
+    reset_instance(instance);
+    *value = code;
+    return SERVER_TRAP;
+  }
+  *value = export->call(instance, args);
+  return SERVER_OK;
+}
+
+static void close_connection(Worker* worker, Connection* connection) {
+  epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+  close(connection->fd);
+  free(connection);
+}
+
+static void accept_connections(Worker* worker) {
+  for (;;) {
+    struct epoll_event event;
+    Connection* connection;
+    int fd = accept4(g_listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        perror("accept");
+      }
+      return;
+    }
+    connection = calloc(1, sizeof(Connection));
+    if (!connection) {
+      close(fd);
+      continue;
+    }
+    connection->fd = fd;
+    connection->events = EPOLLIN | EPOLLRDHUP;
+    event.events = connection->events;
+    event.data.ptr = connection;
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      perror("epoll_ctl");
+      close(fd);
+      free(connection);
+    }
+  }
+}
+
+/* Write as much of the pending output as the socket takes. While some is
+ * left, wait only for EPOLLOUT: input can't be answered until the peer reads,
+ * and level-triggered EPOLLIN, or EPOLLRDHUP after a half-close, would wake
+ * the worker over and over meanwhile. Returns -1 if the connection failed. */
+static int flush_output(Worker* worker, Connection* connection) {
+  struct epoll_event event;
+  size_t written = 0;
+  uint32_t events;
+
+  while (written < connection->out_size) {
+    ssize_t n = send(connection->fd, connection->out + written,
+                     connection->out_size - written, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      return -1;
+    }
+    written += n;
+  }
+  memmove(connection->out, connection->out + written,
+          connection->out_size - written);
+  connection->out_size -= written;
+
+  events = connection->out_size ? EPOLLOUT : EPOLLIN | EPOLLRDHUP;
+  if (events == connection->events) {
+    return 0;
+  }
+  connection->events = events;
+  event.events = events;
+  event.data.ptr = connection;
+  return epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, connection->fd, &event);
+}
+
+/* Answer every complete frame in the input buffer, stopping early if the
+ * output buffer fills up. Returns -1 on a malformed frame. */
+static int process_frames(Worker* worker, Connection* connection) {
+  size_t offset = 0;
+
+  while (connection->in_size - offset >= sizeof(u32) &&
+         connection->out_size + SERVER_RESPONSE_SIZE <= SERVER_BUFFER_SIZE) {
+    unsigned char* out = (unsigned char*)connection->out + connection->out_size;
+    u32 size, value, response_size = 1 + sizeof(u32);
+    memcpy(&size, connection->in + offset, sizeof(u32));
+    if (size > SERVER_MAX_FRAME) {
+      return -1;
+    }
+    if (connection->in_size - offset - sizeof(u32) < size) {
+      break;
+    }
+    out[sizeof(u32)] = handle_request(
+        &worker->instance,
+        (const unsigned char*)connection->in + offset + sizeof(u32), size,
+        &value);
+    memcpy(out, &response_size, sizeof(u32));
+    memcpy(out + sizeof(u32) + 1, &value, sizeof(u32));
+    connection->out_size += SERVER_RESPONSE_SIZE;
+    offset += sizeof(u32) + size;
+  }
+  memmove(connection->in, connection->in + offset,
+          connection->in_size - offset);
+  connection->in_size -= offset;
+  return 0;
+}
+
+/* Returns -1 once the connection should be closed. */
+static int service_connection(Worker* worker, Connection* connection,
+                              uint32_t events) {
+  if (events & EPOLLERR) {
+    return -1;
+  }
+  for (;;) {
+    int drained = 0, closed = 0;
+    if (connection->in_size < SERVER_BUFFER_SIZE) {
+      ssize_t n = recv(connection->fd, connection->in + connection->in_size,
+                       SERVER_BUFFER_SIZE - connection->in_size, 0);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        return -1;
+      }
+      if (n > 0) {
+        connection->in_size += n;
+      }
+      drained = n < 0;
+      closed = n == 0;
+    }
+    if (process_frames(worker, connection) < 0 ||
+        flush_output(worker, connection) < 0) {
+      return -1;
+    }
+    if (closed) {
+      /* Peer closed; drop it once its answers are out. */
+      return connection->out_size ? 0 : -1;
+    }
+    if (drained || connection->out_size) {
+      /* Drained the socket, or waiting for the peer to read. */
+      return 0;
+    }
+  }
+}
+
+static long long now_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+static void print_stats(Worker* worker) {
+  /* Only the heap is read, so no exports are needed. */
+  as_rt_module_t module = {&worker->instance, Z_memory(&worker->instance),
+                           NULL, NULL, NULL};
+  wasm_rt_memory_stats_t memory;
+  as_rt_heap_stats_t heap;
+  char line[512];
+  int length;
+
+  wasm_rt_memory_get_stats(module.memory, &memory);
+  length = snprintf(
+      line, sizeof(line),
+      "stats worker=%ld pages=%u peak_pages=%u max_pages=%u "
+      "resident_bytes=%llu grows=%llu failed_grows=%llu grow_ns=%llu",
+      worker->index, memory.pages, memory.peak_pages, memory.max_pages,
+      (unsigned long long)memory.resident_size,
+      (unsigned long long)memory.grow_count,
+      (unsigned long long)memory.failed_grow_count,
+      (unsigned long long)memory.grow_ns);
+  /* The heap is only set up by the first allocation. */
+  if (as_rt_heap_stats(&module, SERVER_HEAP_ROOT, &heap) == 0) {
+    length += snprintf(
+        line + length, sizeof(line) - length,
+        " heap_bytes=%u used_blocks=%u used_bytes=%u free_blocks=%u "
+        "free_bytes=%u largest_free=%u fragmentation=%.3f",
+        heap.heap_size, heap.used_blocks, heap.used_bytes, heap.free_blocks,
+        heap.free_bytes, heap.largest_free_block,
+        heap.free_bytes
+            ? 1 - (double)heap.largest_free_block / heap.free_bytes
+            : 0.0);
+  }
+  /* One write per line, so lines from different workers do not mix. */
+  printf("%s\n", line);
+  fflush(stdout);
+}
+
+static void* run_worker(void* arg) {
+  Worker* worker = arg;
+  struct epoll_event events[SERVER_MAX_EVENTS];
+  long long next_stats = now_ms() + g_stats_interval_ms;
+
+  for (;;) {
+    int i, count, timeout = -1;
+    if (g_stats_interval_ms >= 0) {
+      long long now = now_ms();
+      if (now >= next_stats) {
+        print_stats(worker);
+        next_stats = now + g_stats_interval_ms;
+      }
+      timeout = (int)(next_stats - now);
+    }
+    count = epoll_wait(worker->epoll_fd, events, SERVER_MAX_EVENTS, timeout);
+    if (count < 0 && errno != EINTR) {
+      perror("epoll_wait");
+      return NULL;
+    }
+    for (i = 0; i < count; ++i) {
+      Connection* connection = events[i].data.ptr;
+      if (!connection) {
+        accept_connections(worker);
+      } else if (service_connection(worker, connection, events[i].events) <
+                 0) {
+        close_connection(worker, connection);
+      }
+    }
+  }
+}
+
+static int listen_on(const char* path) {
+  struct sockaddr_un address;
+  int fd;
+
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "socket path too long: %s\n", path);
+    return -1;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+  unlink(path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+      listen(fd, SOMAXCONN) < 0) {
+    perror(path);
+    return -1;
+  }
+  return fd;
+}
+
+int main(int argc, char** argv) {
+  long worker_count;
+  Worker* workers;
+  long i;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <socket path> [workers] [stats seconds]\n",
+            argv[0]);
+    return 1;
+  }
+  worker_count = argc > 2 ? atol(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+  if (worker_count < 1) {
+    worker_count = 1;
+  }
+  if (argc > 3 && atof(argv[3]) > 0) {
+    g_stats_interval_ms = (int)(atof(argv[3]) * 1000);
+  }
+
+  g_listen_fd = listen_on(argv[1]);
+  if (g_listen_fd < 0) {
+    return 1;
+  }
+
+  /* Initialize the module, then one instance per worker */
+  init();
+  workers = calloc(worker_count, sizeof(Worker));
+  for (i = 0; i < worker_count; ++i) {
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    event.data.ptr = NULL;
+    workers[i].index = i;
+    init_instance(&workers[i].instance);
+    workers[i].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (workers[i].epoll_fd < 0 ||
+        epoll_ctl(workers[i].epoll_fd, EPOLL_CTL_ADD, g_listen_fd, &event) <
+            0 ||
+        pthread_create(&workers[i].thread, NULL, run_worker, &workers[i])) {
+      perror("worker");
+      return 1;
+    }
+  }
+
+  for (i = 0; i < worker_count; ++i) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  return 0;
+}
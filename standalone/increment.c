@@ -7,22 +7,62 @@
 
 #define TRAP(x) (wasm_rt_trap(WASM_RT_TRAP_##x), 0)
 
+#if WASM_RT_PROFILE
+#define PROFILE_STRINGIFY_(x) #x
+#define PROFILE_STRINGIFY(x) PROFILE_STRINGIFY_(x)
+#define PROFILE_ENTER                                                  \
+  static wasm_rt_profile_func_t profile_func = {                       \
+      PROFILE_STRINGIFY(WASM_RT_MODULE_PREFIX), __func__, 0};          \
+  wasm_rt_profile_enter(&profile_func)
+#define PROFILE_EXIT wasm_rt_profile_exit()
+#else
+#define PROFILE_ENTER
+#define PROFILE_EXIT
+#endif
+
+#if WASM_RT_FUEL
+#define FUEL_CHECK \
+  if (UNLIKELY(--wasm_rt_fuel < 0)) wasm_rt_fuel_exhausted()
+#else
+#define FUEL_CHECK
+#endif
+
+#if WASM_RT_STACK_GUARD_PAGE
+#define FUNC_PROLOGUE FUEL_CHECK; PROFILE_ENTER
+#define FUNC_EPILOGUE PROFILE_EXIT
+#else
 #define FUNC_PROLOGUE                                            \
+  FUEL_CHECK;                                                    \
+  PROFILE_ENTER;                                                 \
   if (++wasm_rt_call_stack_depth > WASM_RT_MAX_CALL_STACK_DEPTH) \
     TRAP(EXHAUSTION)
 
-#define FUNC_EPILOGUE --wasm_rt_call_stack_depth
+#define FUNC_EPILOGUE PROFILE_EXIT; --wasm_rt_call_stack_depth
+#endif
 
 #define UNREACHABLE TRAP(UNREACHABLE)
 
+#if WASM_RT_DISPATCH_TABLES
+#define CALL_INDIRECT(table, t, ft, x, ...)                       \
+  (LIKELY((((x) & ~table.mask) |                                  \
+           (table.func_types[(x) & table.mask] ^ func_types[ft])) \
+          == 0)                                                   \
+       ? ((t)table.funcs[(x) & table.mask])(__VA_ARGS__)          \
+       : TRAP(CALL_INDIRECT))
+#else
 #define CALL_INDIRECT(table, t, ft, x, ...)          \
   (LIKELY((x) < table.size && table.data[x].func &&  \
           table.data[x].func_type == func_types[ft]) \
        ? ((t)table.data[x].func)(__VA_ARGS__)        \
        : TRAP(CALL_INDIRECT))
+#endif
 
+#if WASM_RT_MEMCHECK_SIGNAL_HANDLER
+#define MEMCHECK(mem, a, t)
+#else
 #define MEMCHECK(mem, a, t)  \
   if (UNLIKELY((a) + sizeof(t) > mem->size)) TRAP(OOB)
+#endif
 
 #define DEFINE_LOAD(name, t1, t2, t3)              \
   static inline t3 name(wasm_rt_memory_t* mem, u64 addr) {   \
@@ -53,6 +93,7 @@ DEFINE_LOAD(i32_load16_u, u16, u32, u32);
 DEFINE_LOAD(i64_load16_u, u16, u64, u64);
 DEFINE_LOAD(i64_load32_s, s32, s64, u64);
 DEFINE_LOAD(i64_load32_u, u32, u64, u64);
+DEFINE_LOAD(v128_load, v128, v128, v128);
 DEFINE_STORE(i32_store, u32, u32);
 DEFINE_STORE(i64_store, u64, u64);
 DEFINE_STORE(f32_store, f32, f32);
@@ -62,6 +103,7 @@ DEFINE_STORE(i32_store16, u16, u32);
 DEFINE_STORE(i64_store8, u8, u64);
 DEFINE_STORE(i64_store16, u16, u64);
 DEFINE_STORE(i64_store32, u32, u64);
+DEFINE_STORE(v128_store, v128, v128);
 
 #define I32_CLZ(x) ((x) ? __builtin_clz(x) : 32)
 #define I64_CLZ(x) ((x) ? __builtin_clzll(x) : 64)
@@ -146,6 +188,20 @@ DEFINE_REINTERPRET(f64_reinterpret_i64, u64, f64)
 DEFINE_REINTERPRET(i64_reinterpret_f64, f64, u64)
 
 
+#if WASM_RT_STATIC_FUNC_TYPES
+/* Canonical func type IDs; see WASM_RT_STATIC_FUNC_TYPES in wasm-rt.h. Only
+ * read by call_indirect, which a module need not have. */
+__attribute__((unused)) static const u32 func_types[8] = {
+  0x0bca446du, /* (i32) -> () */
+  0xebee7337u, /* (i32, i32) -> () */
+  0x3a50694fu, /* (i32) -> (i32) */
+  0x58b817d3u, /* (i32, i32, i32) -> () */
+  0x4f332085u, /* (i32, i32) -> (i32) */
+  0x117697cdu, /* () -> () */
+  0x24ae7d4fu, /* () -> (i32) */
+  0xc274c759u, /* (i32, i32, i32) -> (i32) */
+};
+#else
 static u32 func_types[8];
 
 static void init_func_types(void) {
@@ -158,43 +214,38 @@ static void init_func_types(void) {
   func_types[6] = wasm_rt_register_func_type(0, 1, WASM_RT_I32);
   func_types[7] = wasm_rt_register_func_type(3, 1, WASM_RT_I32, WASM_RT_I32, WASM_RT_I32, WASM_RT_I32);
 }
+#endif
 
-static void f0(u32, u32);
-static void f1(u32, u32);
-static void f2(u32, u32, u32);
-static u32 f3(void);
-static u32 f4(u32);
-static u32 f5(u32, u32);
-static void f6(u32, u32);
-static void f7(u32, u32, u32);
-static u32 f8(u32, u32, u32);
-static u32 __alloc(u32, u32);
-static void f10(u32);
-static u32 __retain(u32);
-static void __release(u32);
-static u32 loadAndIncrement(u32);
-static void __collect(void);
-static void f15(u32);
-static void f16(u32);
-
-static u32 g0;
-static u32 g1;
-static u32 __rtti_base;
-
-static void init_globals(void) {
-  g0 = 0u;
-  g1 = 0u;
-  __rtti_base = 16u;
-}
+static void f0(WASM_RT_ADD_PREFIX(instance_t)*, u32, u32);
+static void f1(WASM_RT_ADD_PREFIX(instance_t)*, u32, u32);
+static void f2(WASM_RT_ADD_PREFIX(instance_t)*, u32, u32, u32);
+static u32 f3(WASM_RT_ADD_PREFIX(instance_t)*);
+static u32 f4(WASM_RT_ADD_PREFIX(instance_t)*, u32);
+static u32 f5(WASM_RT_ADD_PREFIX(instance_t)*, u32, u32);
+static void f6(WASM_RT_ADD_PREFIX(instance_t)*, u32, u32);
+static void f7(WASM_RT_ADD_PREFIX(instance_t)*, u32, u32, u32);
+static u32 f8(WASM_RT_ADD_PREFIX(instance_t)*, u32, u32, u32);
+static u32 __alloc(WASM_RT_ADD_PREFIX(instance_t)*, u32, u32);
+static void f10(WASM_RT_ADD_PREFIX(instance_t)*, u32);
+static u32 __retain(WASM_RT_ADD_PREFIX(instance_t)*, u32);
+static void __release(WASM_RT_ADD_PREFIX(instance_t)*, u32);
+static u32 loadAndIncrement(WASM_RT_ADD_PREFIX(instance_t)*, u32);
+static void __collect(WASM_RT_ADD_PREFIX(instance_t)*);
+static void f15(WASM_RT_ADD_PREFIX(instance_t)*, u32);
+static void f16(WASM_RT_ADD_PREFIX(instance_t)*, u32);
 
-static wasm_rt_memory_t memory;
+static void init_globals(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  instance->g0 = 0u;
+  instance->g1 = 0u;
+  instance->__rtti_base = 16u;
+}
 
-static void f0(u32 p0, u32 p1) {
+static void f0(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0, u32 p1) {
   u32 l2 = 0, l3 = 0, l4 = 0, l5 = 0;
   FUNC_PROLOGUE;
   u32 i0, i1, i2, i3, i4;
   i0 = p1;
-  i0 = i32_load((&memory), (u64)(i0));
+  i0 = i32_load((&instance->memory), (u64)(i0));
   l3 = i0;
   i1 = 1u;
   i0 &= i1;
@@ -260,21 +311,21 @@ static void f0(u32 p0, u32 p1) {
     UNREACHABLE;
   }
   i0 = p1;
-  i0 = i32_load((&memory), (u64)(i0 + 20));
+  i0 = i32_load((&instance->memory), (u64)(i0 + 20));
   l4 = i0;
   i0 = p1;
-  i0 = i32_load((&memory), (u64)(i0 + 16));
+  i0 = i32_load((&instance->memory), (u64)(i0 + 16));
   l5 = i0;
   if (i0) {
     i0 = l5;
     i1 = l4;
-    i32_store((&memory), (u64)(i0 + 20), i1);
+    i32_store((&instance->memory), (u64)(i0 + 20), i1);
   }
   i0 = l4;
   if (i0) {
     i0 = l4;
     i1 = l5;
-    i32_store((&memory), (u64)(i0 + 16), i1);
+    i32_store((&instance->memory), (u64)(i0 + 16), i1);
   }
   i0 = p1;
   i1 = p0;
@@ -286,7 +337,7 @@ static void f0(u32 p0, u32 p1) {
   i3 = 2u;
   i2 <<= (i3 & 31);
   i1 += i2;
-  i1 = i32_load((&memory), (u64)(i1 + 96));
+  i1 = i32_load((&instance->memory), (u64)(i1 + 96));
   i0 = i0 == i1;
   if (i0) {
     i0 = p0;
@@ -299,7 +350,7 @@ static void f0(u32 p0, u32 p1) {
     i1 <<= (i2 & 31);
     i0 += i1;
     i1 = l4;
-    i32_store((&memory), (u64)(i0 + 96), i1);
+    i32_store((&instance->memory), (u64)(i0 + 96), i1);
     i0 = l4;
     i0 = !(i0);
     if (i0) {
@@ -313,7 +364,7 @@ static void f0(u32 p0, u32 p1) {
       i3 = 2u;
       i2 <<= (i3 & 31);
       i1 += i2;
-      i1 = i32_load((&memory), (u64)(i1 + 4));
+      i1 = i32_load((&instance->memory), (u64)(i1 + 4));
       i2 = 1u;
       i3 = l2;
       i2 <<= (i3 & 31);
@@ -321,27 +372,27 @@ static void f0(u32 p0, u32 p1) {
       i2 ^= i3;
       i1 &= i2;
       p1 = i1;
-      i32_store((&memory), (u64)(i0 + 4), i1);
+      i32_store((&instance->memory), (u64)(i0 + 4), i1);
       i0 = p1;
       i0 = !(i0);
       if (i0) {
         i0 = p0;
         i1 = p0;
-        i1 = i32_load((&memory), (u64)(i1));
+        i1 = i32_load((&instance->memory), (u64)(i1));
         i2 = 1u;
         i3 = l3;
         i2 <<= (i3 & 31);
         i3 = 4294967295u;
         i2 ^= i3;
         i1 &= i2;
-        i32_store((&memory), (u64)(i0), i1);
+        i32_store((&instance->memory), (u64)(i0), i1);
       }
     }
   }
   FUNC_EPILOGUE;
 }
 
-static void f1(u32 p0, u32 p1) {
+static void f1(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0, u32 p1) {
   u32 l2 = 0, l3 = 0, l4 = 0, l5 = 0, l6 = 0, l7 = 0;
   FUNC_PROLOGUE;
   u32 i0, i1, i2, i3;
@@ -351,7 +402,7 @@ static void f1(u32 p0, u32 p1) {
     UNREACHABLE;
   }
   i0 = p1;
-  i0 = i32_load((&memory), (u64)(i0));
+  i0 = i32_load((&instance->memory), (u64)(i0));
   l3 = i0;
   i1 = 1u;
   i0 &= i1;
@@ -363,12 +414,12 @@ static void f1(u32 p0, u32 p1) {
   i1 = 16u;
   i0 += i1;
   i1 = p1;
-  i1 = i32_load((&memory), (u64)(i1));
+  i1 = i32_load((&instance->memory), (u64)(i1));
   i2 = 4294967292u;
   i1 &= i2;
   i0 += i1;
   l4 = i0;
-  i0 = i32_load((&memory), (u64)(i0));
+  i0 = i32_load((&instance->memory), (u64)(i0));
   l5 = i0;
   i1 = 1u;
   i0 &= i1;
@@ -388,7 +439,7 @@ static void f1(u32 p0, u32 p1) {
     if (i0) {
       i0 = p0;
       i1 = l4;
-      f0(i0, i1);
+      f0(instance, i0, i1);
       i0 = p1;
       i1 = l2;
       i2 = l3;
@@ -396,17 +447,17 @@ static void f1(u32 p0, u32 p1) {
       i2 &= i3;
       i1 |= i2;
       l3 = i1;
-      i32_store((&memory), (u64)(i0), i1);
+      i32_store((&instance->memory), (u64)(i0), i1);
       i0 = p1;
       i1 = 16u;
       i0 += i1;
       i1 = p1;
-      i1 = i32_load((&memory), (u64)(i1));
+      i1 = i32_load((&instance->memory), (u64)(i1));
       i2 = 4294967292u;
       i1 &= i2;
       i0 += i1;
       l4 = i0;
-      i0 = i32_load((&memory), (u64)(i0));
+      i0 = i32_load((&instance->memory), (u64)(i0));
       l5 = i0;
     }
   }
@@ -417,9 +468,9 @@ static void f1(u32 p0, u32 p1) {
     i0 = p1;
     i1 = 4u;
     i0 -= i1;
-    i0 = i32_load((&memory), (u64)(i0));
+    i0 = i32_load((&instance->memory), (u64)(i0));
     l2 = i0;
-    i0 = i32_load((&memory), (u64)(i0));
+    i0 = i32_load((&instance->memory), (u64)(i0));
     l6 = i0;
     i1 = 1u;
     i0 &= i1;
@@ -442,7 +493,7 @@ static void f1(u32 p0, u32 p1) {
     if (i0) {
       i0 = p0;
       i1 = l2;
-      f0(i0, i1);
+      f0(instance, i0, i1);
       i0 = l2;
       i1 = l7;
       i2 = l6;
@@ -450,7 +501,7 @@ static void f1(u32 p0, u32 p1) {
       i2 &= i3;
       i1 |= i2;
       l3 = i1;
-      i32_store((&memory), (u64)(i0), i1);
+      i32_store((&instance->memory), (u64)(i0), i1);
       i0 = l2;
       p1 = i0;
     }
@@ -459,7 +510,7 @@ static void f1(u32 p0, u32 p1) {
   i1 = l5;
   i2 = 2u;
   i1 |= i2;
-  i32_store((&memory), (u64)(i0), i1);
+  i32_store((&instance->memory), (u64)(i0), i1);
   i0 = l3;
   i1 = 4294967292u;
   i0 &= i1;
@@ -491,7 +542,7 @@ static void f1(u32 p0, u32 p1) {
   i1 = 4u;
   i0 -= i1;
   i1 = p1;
-  i32_store((&memory), (u64)(i0), i1);
+  i32_store((&instance->memory), (u64)(i0), i1);
   i0 = l2;
   i1 = 256u;
   i0 = i0 < i1;
@@ -541,19 +592,19 @@ static void f1(u32 p0, u32 p1) {
   i2 = 2u;
   i1 <<= (i2 & 31);
   i0 += i1;
-  i0 = i32_load((&memory), (u64)(i0 + 96));
+  i0 = i32_load((&instance->memory), (u64)(i0 + 96));
   l2 = i0;
   i0 = p1;
   i1 = 0u;
-  i32_store((&memory), (u64)(i0 + 16), i1);
+  i32_store((&instance->memory), (u64)(i0 + 16), i1);
   i0 = p1;
   i1 = l2;
-  i32_store((&memory), (u64)(i0 + 20), i1);
+  i32_store((&instance->memory), (u64)(i0 + 20), i1);
   i0 = l2;
   if (i0) {
     i0 = l2;
     i1 = p1;
-    i32_store((&memory), (u64)(i0 + 16), i1);
+    i32_store((&instance->memory), (u64)(i0 + 16), i1);
   }
   i0 = p0;
   i1 = l4;
@@ -565,15 +616,15 @@ static void f1(u32 p0, u32 p1) {
   i1 <<= (i2 & 31);
   i0 += i1;
   i1 = p1;
-  i32_store((&memory), (u64)(i0 + 96), i1);
+  i32_store((&instance->memory), (u64)(i0 + 96), i1);
   i0 = p0;
   i1 = p0;
-  i1 = i32_load((&memory), (u64)(i1));
+  i1 = i32_load((&instance->memory), (u64)(i1));
   i2 = 1u;
   i3 = l3;
   i2 <<= (i3 & 31);
   i1 |= i2;
-  i32_store((&memory), (u64)(i0), i1);
+  i32_store((&instance->memory), (u64)(i0), i1);
   i0 = p0;
   i1 = l3;
   i2 = 2u;
@@ -584,16 +635,16 @@ static void f1(u32 p0, u32 p1) {
   i3 = 2u;
   i2 <<= (i3 & 31);
   i1 += i2;
-  i1 = i32_load((&memory), (u64)(i1 + 4));
+  i1 = i32_load((&instance->memory), (u64)(i1 + 4));
   i2 = 1u;
   i3 = l4;
   i2 <<= (i3 & 31);
   i1 |= i2;
-  i32_store((&memory), (u64)(i0 + 4), i1);
+  i32_store((&instance->memory), (u64)(i0 + 4), i1);
   FUNC_EPILOGUE;
 }
 
-static void f2(u32 p0, u32 p1, u32 p2) {
+static void f2(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0, u32 p1, u32 p2) {
   u32 l3 = 0, l4 = 0;
   FUNC_PROLOGUE;
   u32 i0, i1, i2, i3, i4, i5;
@@ -617,7 +668,7 @@ static void f2(u32 p0, u32 p1, u32 p2) {
     UNREACHABLE;
   }
   i0 = p0;
-  i0 = i32_load((&memory), (u64)(i0 + 1568));
+  i0 = i32_load((&instance->memory), (u64)(i0 + 1568));
   l3 = i0;
   if (i0) {
     i0 = p1;
@@ -635,7 +686,7 @@ static void f2(u32 p0, u32 p1, u32 p2) {
     i0 = i0 == i1;
     if (i0) {
       i0 = l3;
-      i0 = i32_load((&memory), (u64)(i0));
+      i0 = i32_load((&instance->memory), (u64)(i0));
       l4 = i0;
       i0 = p1;
       i1 = 16u;
@@ -671,13 +722,13 @@ static void f2(u32 p0, u32 p1, u32 p2) {
   i3 = 1u;
   i2 |= i3;
   i1 |= i2;
-  i32_store((&memory), (u64)(i0), i1);
+  i32_store((&instance->memory), (u64)(i0), i1);
   i0 = p1;
   i1 = 0u;
-  i32_store((&memory), (u64)(i0 + 16), i1);
+  i32_store((&instance->memory), (u64)(i0 + 16), i1);
   i0 = p1;
   i1 = 0u;
-  i32_store((&memory), (u64)(i0 + 20), i1);
+  i32_store((&instance->memory), (u64)(i0 + 20), i1);
   i0 = p1;
   i1 = p2;
   i0 += i1;
@@ -685,34 +736,34 @@ static void f2(u32 p0, u32 p1, u32 p2) {
   i0 -= i1;
   p2 = i0;
   i1 = 2u;
-  i32_store((&memory), (u64)(i0), i1);
+  i32_store((&instance->memory), (u64)(i0), i1);
   i0 = p0;
   i1 = p2;
-  i32_store((&memory), (u64)(i0 + 1568), i1);
+  i32_store((&instance->memory), (u64)(i0 + 1568), i1);
   i0 = p0;
   i1 = p1;
-  f1(i0, i1);
+  f1(instance, i0, i1);
   Bfunc:;
   FUNC_EPILOGUE;
 }
 
-static u32 f3(void) {
+static u32 f3(WASM_RT_ADD_PREFIX(instance_t)* instance) {
   u32 l0 = 0, l1 = 0, l2 = 0;
   FUNC_PROLOGUE;
   u32 i0, i1, i2, i3;
-  i0 = g0;
+  i0 = instance->g0;
   l0 = i0;
   i0 = !(i0);
   if (i0) {
     i0 = 1u;
-    i1 = memory.pages;
+    i1 = instance->memory.pages;
     l0 = i1;
     i0 = (u32)((s32)i0 > (s32)i1);
     if (i0) {
       i0 = 1u;
       i1 = l0;
       i0 -= i1;
-      i0 = wasm_rt_grow_memory((&memory), i0);
+      i0 = wasm_rt_grow_memory((&instance->memory), i0);
       i1 = 0u;
       i0 = (u32)((s32)i0 < (s32)i1);
     } else {
@@ -724,10 +775,10 @@ static u32 f3(void) {
     i0 = 48u;
     l0 = i0;
     i1 = 0u;
-    i32_store((&memory), (u64)(i0), i1);
+    i32_store((&instance->memory), (u64)(i0), i1);
     i0 = 1616u;
     i1 = 0u;
-    i32_store((&memory), (u64)(i0), i1);
+    i32_store((&instance->memory), (u64)(i0), i1);
     L3: 
       i0 = l1;
       i1 = 23u;
@@ -739,7 +790,7 @@ static u32 f3(void) {
         i1 = 48u;
         i0 += i1;
         i1 = 0u;
-        i32_store((&memory), (u64)(i0 + 4), i1);
+        i32_store((&instance->memory), (u64)(i0 + 4), i1);
         i0 = 0u;
         l2 = i0;
         L5: 
@@ -757,34 +808,36 @@ static u32 f3(void) {
             i1 = 48u;
             i0 += i1;
             i1 = 0u;
-            i32_store((&memory), (u64)(i0 + 96), i1);
+            i32_store((&instance->memory), (u64)(i0 + 96), i1);
             i0 = l2;
             i1 = 1u;
             i0 += i1;
             l2 = i0;
+            FUEL_CHECK;
             goto L5;
           }
         i0 = l1;
         i1 = 1u;
         i0 += i1;
         l1 = i0;
+        FUEL_CHECK;
         goto L3;
       }
     i0 = 48u;
     i1 = 1632u;
-    i2 = memory.pages;
+    i2 = instance->memory.pages;
     i3 = 16u;
     i2 <<= (i3 & 31);
-    f2(i0, i1, i2);
+    f2(instance, i0, i1, i2);
     i0 = 48u;
-    g0 = i0;
+    instance->g0 = i0;
   }
   i0 = l0;
   FUNC_EPILOGUE;
   return i0;
 }
 
-static u32 f4(u32 p0) {
+static u32 f4(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0) {
   FUNC_PROLOGUE;
   u32 i0, i1, i2, i3;
   i0 = p0;
@@ -808,7 +861,7 @@ static u32 f4(u32 p0) {
   return i0;
 }
 
-static u32 f5(u32 p0, u32 p1) {
+static u32 f5(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0, u32 p1) {
   u32 l2 = 0;
   FUNC_PROLOGUE;
   u32 i0, i1, i2, i3;
@@ -873,7 +926,7 @@ static u32 f5(u32 p0, u32 p1) {
   i2 = 2u;
   i1 <<= (i2 & 31);
   i0 += i1;
-  i0 = i32_load((&memory), (u64)(i0 + 4));
+  i0 = i32_load((&instance->memory), (u64)(i0 + 4));
   i1 = 4294967295u;
   i2 = p1;
   i1 <<= (i2 & 31);
@@ -890,10 +943,10 @@ static u32 f5(u32 p0, u32 p1) {
     i2 = 2u;
     i1 <<= (i2 & 31);
     i0 += i1;
-    i0 = i32_load((&memory), (u64)(i0 + 96));
+    i0 = i32_load((&instance->memory), (u64)(i0 + 96));
   } else {
     i0 = p0;
-    i0 = i32_load((&memory), (u64)(i0));
+    i0 = i32_load((&instance->memory), (u64)(i0));
     i1 = 4294967295u;
     i2 = l2;
     i3 = 1u;
@@ -909,7 +962,7 @@ static u32 f5(u32 p0, u32 p1) {
       i2 = 2u;
       i1 <<= (i2 & 31);
       i0 += i1;
-      i0 = i32_load((&memory), (u64)(i0 + 4));
+      i0 = i32_load((&instance->memory), (u64)(i0 + 4));
       l2 = i0;
       i0 = !(i0);
       if (i0) {
@@ -925,7 +978,7 @@ static u32 f5(u32 p0, u32 p1) {
       i2 = 2u;
       i1 <<= (i2 & 31);
       i0 += i1;
-      i0 = i32_load((&memory), (u64)(i0 + 96));
+      i0 = i32_load((&instance->memory), (u64)(i0 + 96));
     } else {
       i0 = 0u;
     }
@@ -934,15 +987,15 @@ static u32 f5(u32 p0, u32 p1) {
   return i0;
 }
 
-static void f6(u32 p0, u32 p1) {
+static void f6(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0, u32 p1) {
   u32 l2 = 0;
   FUNC_PROLOGUE;
   u32 i0, i1, i2, i3, i4, i5;
-  i0 = memory.pages;
+  i0 = instance->memory.pages;
   l2 = i0;
   i1 = 16u;
   i2 = p0;
-  i2 = i32_load((&memory), (u64)(i2 + 1568));
+  i2 = i32_load((&instance->memory), (u64)(i2 + 1568));
   i3 = l2;
   i4 = 16u;
   i3 <<= (i4 & 31);
@@ -977,12 +1030,12 @@ static void f6(u32 p0, u32 p1) {
   i3 = p1;
   i2 = (u32)((s32)i2 > (s32)i3);
   i0 = i2 ? i0 : i1;
-  i0 = wasm_rt_grow_memory((&memory), i0);
+  i0 = wasm_rt_grow_memory((&instance->memory), i0);
   i1 = 0u;
   i0 = (u32)((s32)i0 < (s32)i1);
   if (i0) {
     i0 = p1;
-    i0 = wasm_rt_grow_memory((&memory), i0);
+    i0 = wasm_rt_grow_memory((&instance->memory), i0);
     i1 = 0u;
     i0 = (u32)((s32)i0 < (s32)i1);
     if (i0) {
@@ -993,19 +1046,19 @@ static void f6(u32 p0, u32 p1) {
   i1 = l2;
   i2 = 16u;
   i1 <<= (i2 & 31);
-  i2 = memory.pages;
+  i2 = instance->memory.pages;
   i3 = 16u;
   i2 <<= (i3 & 31);
-  f2(i0, i1, i2);
+  f2(instance, i0, i1, i2);
   FUNC_EPILOGUE;
 }
 
-static void f7(u32 p0, u32 p1, u32 p2) {
+static void f7(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0, u32 p1, u32 p2) {
   u32 l3 = 0, l4 = 0;
   FUNC_PROLOGUE;
   u32 i0, i1, i2, i3;
   i0 = p1;
-  i0 = i32_load((&memory), (u64)(i0));
+  i0 = i32_load((&instance->memory), (u64)(i0));
   l3 = i0;
   i0 = p2;
   i1 = 15u;
@@ -1028,7 +1081,7 @@ static void f7(u32 p0, u32 p1, u32 p2) {
     i3 = 2u;
     i2 &= i3;
     i1 |= i2;
-    i32_store((&memory), (u64)(i0), i1);
+    i32_store((&instance->memory), (u64)(i0), i1);
     i0 = p2;
     i1 = p1;
     i2 = 16u;
@@ -1040,21 +1093,21 @@ static void f7(u32 p0, u32 p1, u32 p2) {
     i1 -= i2;
     i2 = 1u;
     i1 |= i2;
-    i32_store((&memory), (u64)(i0), i1);
+    i32_store((&instance->memory), (u64)(i0), i1);
     i0 = p0;
     i1 = p1;
-    f1(i0, i1);
+    f1(instance, i0, i1);
   } else {
     i0 = p1;
     i1 = l3;
     i2 = 4294967294u;
     i1 &= i2;
-    i32_store((&memory), (u64)(i0), i1);
+    i32_store((&instance->memory), (u64)(i0), i1);
     i0 = p1;
     i1 = 16u;
     i0 += i1;
     i1 = p1;
-    i1 = i32_load((&memory), (u64)(i1));
+    i1 = i32_load((&instance->memory), (u64)(i1));
     i2 = 4294967292u;
     i1 &= i2;
     i0 += i1;
@@ -1062,50 +1115,50 @@ static void f7(u32 p0, u32 p1, u32 p2) {
     i2 = 16u;
     i1 += i2;
     i2 = p1;
-    i2 = i32_load((&memory), (u64)(i2));
+    i2 = i32_load((&instance->memory), (u64)(i2));
     i3 = 4294967292u;
     i2 &= i3;
     i1 += i2;
-    i1 = i32_load((&memory), (u64)(i1));
+    i1 = i32_load((&instance->memory), (u64)(i1));
     i2 = 4294967293u;
     i1 &= i2;
-    i32_store((&memory), (u64)(i0), i1);
+    i32_store((&instance->memory), (u64)(i0), i1);
   }
   FUNC_EPILOGUE;
 }
 
-static u32 f8(u32 p0, u32 p1, u32 p2) {
+static u32 f8(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0, u32 p1, u32 p2) {
   u32 l3 = 0, l4 = 0;
   FUNC_PROLOGUE;
   u32 i0, i1, i2;
-  i0 = g1;
+  i0 = instance->g1;
   if (i0) {
     UNREACHABLE;
   }
   i0 = p0;
   i1 = p1;
-  i1 = f4(i1);
+  i1 = f4(instance, i1);
   l4 = i1;
-  i0 = f5(i0, i1);
+  i0 = f5(instance, i0, i1);
   l3 = i0;
   i0 = !(i0);
   if (i0) {
     i0 = 1u;
-    g1 = i0;
+    instance->g1 = i0;
     i0 = 0u;
-    g1 = i0;
+    instance->g1 = i0;
     i0 = p0;
     i1 = l4;
-    i0 = f5(i0, i1);
+    i0 = f5(instance, i0, i1);
     l3 = i0;
     i0 = !(i0);
     if (i0) {
       i0 = p0;
       i1 = l4;
-      f6(i0, i1);
+      f6(instance, i0, i1);
       i0 = p0;
       i1 = l4;
-      i0 = f5(i0, i1);
+      i0 = f5(instance, i0, i1);
       l3 = i0;
       i0 = !(i0);
       if (i0) {
@@ -1114,7 +1167,7 @@ static u32 f8(u32 p0, u32 p1, u32 p2) {
     }
   }
   i0 = l3;
-  i0 = i32_load((&memory), (u64)(i0));
+  i0 = i32_load((&instance->memory), (u64)(i0));
   i1 = 4294967292u;
   i0 &= i1;
   i1 = l4;
@@ -1124,44 +1177,44 @@ static u32 f8(u32 p0, u32 p1, u32 p2) {
   }
   i0 = l3;
   i1 = 0u;
-  i32_store((&memory), (u64)(i0 + 4), i1);
+  i32_store((&instance->memory), (u64)(i0 + 4), i1);
   i0 = l3;
   i1 = p2;
-  i32_store((&memory), (u64)(i0 + 8), i1);
+  i32_store((&instance->memory), (u64)(i0 + 8), i1);
   i0 = l3;
   i1 = p1;
-  i32_store((&memory), (u64)(i0 + 12), i1);
+  i32_store((&instance->memory), (u64)(i0 + 12), i1);
   i0 = p0;
   i1 = l3;
-  f0(i0, i1);
+  f0(instance, i0, i1);
   i0 = p0;
   i1 = l3;
   i2 = l4;
-  f7(i0, i1, i2);
+  f7(instance, i0, i1, i2);
   i0 = l3;
   FUNC_EPILOGUE;
   return i0;
 }
 
-static u32 __alloc(u32 p0, u32 p1) {
+static u32 __alloc(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0, u32 p1) {
   FUNC_PROLOGUE;
   u32 i0, i1, i2;
-  i0 = f3();
+  i0 = f3(instance);
   i1 = p0;
   i2 = p1;
-  i0 = f8(i0, i1, i2);
+  i0 = f8(instance, i0, i1, i2);
   i1 = 16u;
   i0 += i1;
   FUNC_EPILOGUE;
   return i0;
 }
 
-static void f10(u32 p0) {
+static void f10(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0) {
   u32 l1 = 0;
   FUNC_PROLOGUE;
   u32 i0, i1, i2;
   i0 = p0;
-  i0 = i32_load((&memory), (u64)(i0 + 4));
+  i0 = i32_load((&instance->memory), (u64)(i0 + 4));
   l1 = i0;
   i1 = 4026531840u;
   i0 &= i1;
@@ -1178,9 +1231,9 @@ static void f10(u32 p0) {
   i1 = l1;
   i2 = 1u;
   i1 += i2;
-  i32_store((&memory), (u64)(i0 + 4), i1);
+  i32_store((&instance->memory), (u64)(i0 + 4), i1);
   i0 = p0;
-  i0 = i32_load((&memory), (u64)(i0));
+  i0 = i32_load((&instance->memory), (u64)(i0));
   i1 = 1u;
   i0 &= i1;
   if (i0) {
@@ -1189,7 +1242,7 @@ static void f10(u32 p0) {
   FUNC_EPILOGUE;
 }
 
-static u32 __retain(u32 p0) {
+static u32 __retain(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0) {
   FUNC_PROLOGUE;
   u32 i0, i1;
   i0 = p0;
@@ -1199,14 +1252,14 @@ static u32 __retain(u32 p0) {
     i0 = p0;
     i1 = 16u;
     i0 -= i1;
-    f10(i0);
+    f10(instance, i0);
   }
   i0 = p0;
   FUNC_EPILOGUE;
   return i0;
 }
 
-static void __release(u32 p0) {
+static void __release(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0) {
   FUNC_PROLOGUE;
   u32 i0, i1;
   i0 = p0;
@@ -1216,39 +1269,39 @@ static void __release(u32 p0) {
     i0 = p0;
     i1 = 16u;
     i0 -= i1;
-    f15(i0);
+    f15(instance, i0);
   }
   FUNC_EPILOGUE;
 }
 
-static u32 loadAndIncrement(u32 p0) {
+static u32 loadAndIncrement(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0) {
   FUNC_PROLOGUE;
   u32 i0, i1;
   i0 = p0;
-  i0 = i32_load((&memory), (u64)(i0));
+  i0 = i32_load((&instance->memory), (u64)(i0));
   i1 = 1u;
   i0 += i1;
   FUNC_EPILOGUE;
   return i0;
 }
 
-static void __collect(void) {
+static void __collect(WASM_RT_ADD_PREFIX(instance_t)* instance) {
   FUNC_PROLOGUE;
   FUNC_EPILOGUE;
 }
 
-static void f15(u32 p0) {
+static void f15(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0) {
   u32 l1 = 0, l2 = 0;
   FUNC_PROLOGUE;
   u32 i0, i1, i2, i3;
   i0 = p0;
-  i0 = i32_load((&memory), (u64)(i0 + 4));
+  i0 = i32_load((&instance->memory), (u64)(i0 + 4));
   l2 = i0;
   i1 = 268435455u;
   i0 &= i1;
   l1 = i0;
   i0 = p0;
-  i0 = i32_load((&memory), (u64)(i0));
+  i0 = i32_load((&instance->memory), (u64)(i0));
   i1 = 1u;
   i0 &= i1;
   if (i0) {
@@ -1261,7 +1314,7 @@ static void f15(u32 p0) {
     i0 = p0;
     i1 = 16u;
     i0 += i1;
-    f16(i0);
+    f16(instance, i0);
     i0 = l2;
     i1 = 2147483648u;
     i0 &= i1;
@@ -1270,13 +1323,13 @@ static void f15(u32 p0) {
     }
     i0 = p0;
     i1 = p0;
-    i1 = i32_load((&memory), (u64)(i1));
+    i1 = i32_load((&instance->memory), (u64)(i1));
     i2 = 1u;
     i1 |= i2;
-    i32_store((&memory), (u64)(i0), i1);
-    i0 = g0;
+    i32_store((&instance->memory), (u64)(i0), i1);
+    i0 = instance->g0;
     i1 = p0;
-    f1(i0, i1);
+    f1(instance, i0, i1);
   } else {
     i0 = l1;
     i1 = 0u;
@@ -1292,18 +1345,18 @@ static void f15(u32 p0) {
     i3 = 4026531840u;
     i2 &= i3;
     i1 |= i2;
-    i32_store((&memory), (u64)(i0 + 4), i1);
+    i32_store((&instance->memory), (u64)(i0 + 4), i1);
   }
   FUNC_EPILOGUE;
 }
 
-static void f16(u32 p0) {
+static void f16(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0) {
   FUNC_PROLOGUE;
   u32 i0, i1;
   i0 = p0;
   i1 = 8u;
   i0 -= i1;
-  i0 = i32_load((&memory), (u64)(i0));
+  i0 = i32_load((&instance->memory), (u64)(i0));
   switch (i0) {
     case 0: goto B2;
     case 1: goto B2;
@@ -1314,7 +1367,7 @@ static void f16(u32 p0) {
   goto Bfunc;
   B1:;
   i0 = p0;
-  i0 = i32_load((&memory), (u64)(i0));
+  i0 = i32_load((&instance->memory), (u64)(i0));
   p0 = i0;
   if (i0) {
     i0 = p0;
@@ -1324,7 +1377,7 @@ static void f16(u32 p0) {
       i0 = p0;
       i1 = 16u;
       i0 -= i1;
-      f15(i0);
+      f15(instance, i0);
     }
   }
   goto Bfunc;
@@ -1339,51 +1392,90 @@ static const u8 data_segment_data_0[] = {
   0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 
 };
 
-static void init_memory(void) {
-  wasm_rt_allocate_memory((&memory), 1, 65536);
-  memcpy(&(memory.data[16u]), data_segment_data_0, 21);
+static void init_data_segments(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  wasm_rt_memory_init((&instance->memory), 16u, data_segment_data_0, 21, 0, 21);
+}
+
+static void init_memory(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  wasm_rt_allocate_memory((&instance->memory), 1, 65536);
+  init_data_segments(instance);
 }
 
-static void init_table(void) {
+static u64 reset_memory(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  u64 reset_size = wasm_rt_reset_memory((&instance->memory), 1);
+  init_data_segments(instance);
+  return reset_size;
+}
+
+static void init_table(WASM_RT_ADD_PREFIX(instance_t)* instance) {
   uint32_t offset;
 }
 
 /* export: 'memory' */
-wasm_rt_memory_t (*WASM_RT_ADD_PREFIX(Z_memory));
+wasm_rt_memory_t* WASM_RT_ADD_PREFIX(Z_memory)(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  return (&instance->memory);
+}
+
 /* export: '__alloc' */
-u32 (*WASM_RT_ADD_PREFIX(Z___allocZ_iii))(u32, u32);
+u32 WASM_RT_ADD_PREFIX(Z___allocZ_iii)(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0, u32 p1) {
+  return __alloc(instance, p0, p1);
+}
+
 /* export: '__retain' */
-u32 (*WASM_RT_ADD_PREFIX(Z___retainZ_ii))(u32);
+u32 WASM_RT_ADD_PREFIX(Z___retainZ_ii)(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0) {
+  return __retain(instance, p0);
+}
+
 /* export: '__release' */
-void (*WASM_RT_ADD_PREFIX(Z___releaseZ_vi))(u32);
+void WASM_RT_ADD_PREFIX(Z___releaseZ_vi)(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0) {
+  __release(instance, p0);
+}
+
 /* export: '__collect' */
-void (*WASM_RT_ADD_PREFIX(Z___collectZ_vv))(void);
+void WASM_RT_ADD_PREFIX(Z___collectZ_vv)(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  __collect(instance);
+}
+
 /* export: '__rtti_base' */
-u32 (*WASM_RT_ADD_PREFIX(Z___rtti_baseZ_i));
+u32* WASM_RT_ADD_PREFIX(Z___rtti_baseZ_i)(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  return (&instance->__rtti_base);
+}
+
 /* export: 'loadAndIncrement' */
-u32 (*WASM_RT_ADD_PREFIX(Z_loadAndIncrementZ_ii))(u32);
-
-static void init_exports(void) {
-  /* export: 'memory' */
-  WASM_RT_ADD_PREFIX(Z_memory) = (&memory);
-  /* export: '__alloc' */
-  WASM_RT_ADD_PREFIX(Z___allocZ_iii) = (&__alloc);
-  /* export: '__retain' */
-  WASM_RT_ADD_PREFIX(Z___retainZ_ii) = (&__retain);
-  /* export: '__release' */
-  WASM_RT_ADD_PREFIX(Z___releaseZ_vi) = (&__release);
-  /* export: '__collect' */
-  WASM_RT_ADD_PREFIX(Z___collectZ_vv) = (&__collect);
-  /* export: '__rtti_base' */
-  WASM_RT_ADD_PREFIX(Z___rtti_baseZ_i) = (&__rtti_base);
-  /* export: 'loadAndIncrement' */
-  WASM_RT_ADD_PREFIX(Z_loadAndIncrementZ_ii) = (&loadAndIncrement);
+u32 WASM_RT_ADD_PREFIX(Z_loadAndIncrementZ_ii)(WASM_RT_ADD_PREFIX(instance_t)* instance, u32 p0) {
+  return loadAndIncrement(instance, p0);
 }
 
 void WASM_RT_ADD_PREFIX(init)(void) {
+#if !WASM_RT_STATIC_FUNC_TYPES
   init_func_types();
-  init_globals();
-  init_memory();
-  init_table();
-  init_exports();
+#endif
+}
+
+void WASM_RT_ADD_PREFIX(init_instance)(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  init_globals(instance);
+  init_memory(instance);
+  init_table(instance);
+}
+
+u64 WASM_RT_ADD_PREFIX(reset_instance)(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  init_globals(instance);
+  return reset_memory(instance);
+}
+
+#if WASM_RT_USE_MMAP
+void WASM_RT_ADD_PREFIX(init_instance_from_snapshot)(WASM_RT_ADD_PREFIX(instance_t)* instance, const wasm_rt_memory_snapshot_t* snapshot) {
+  init_globals(instance);
+  wasm_rt_allocate_memory_from_snapshot((&instance->memory), snapshot);
+  init_table(instance);
+}
+
+u64 WASM_RT_ADD_PREFIX(reset_instance_from_snapshot)(WASM_RT_ADD_PREFIX(instance_t)* instance, const wasm_rt_memory_snapshot_t* snapshot) {
+  init_globals(instance);
+  return wasm_rt_reset_memory((&instance->memory), snapshot->pages);
+}
+#endif
+
+void WASM_RT_ADD_PREFIX(free_instance)(WASM_RT_ADD_PREFIX(instance_t)* instance) {
+  wasm_rt_free_memory((&instance->memory));
 }
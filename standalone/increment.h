@@ -27,23 +27,45 @@ typedef uint64_t u64;
 typedef int64_t s64;
 typedef float f32;
 typedef double f64;
+typedef wasm_rt_v128 v128;
 
+/* The state of one instance of the module. Any number of instances can be
+ * live at once; each owns its own memory and globals. */
+typedef struct WASM_RT_ADD_PREFIX(instance_t) {
+  /* memory: 'memory' */
+  wasm_rt_memory_t memory;
+  /* globals */
+  u32 g0;
+  u32 g1;
+  u32 __rtti_base;
+} WASM_RT_ADD_PREFIX(instance_t);
+
+/* Module-wide initialization; call once before initializing any instance. */
 extern void WASM_RT_ADD_PREFIX(init)(void);
+extern void WASM_RT_ADD_PREFIX(init_instance)(WASM_RT_ADD_PREFIX(instance_t)*);
+/* Return an instance to the state `init_instance` left it in, reusing its
+ * memory. Returns the number of bytes of memory that had to be reset. */
+extern u64 WASM_RT_ADD_PREFIX(reset_instance)(WASM_RT_ADD_PREFIX(instance_t)*);
+#if WASM_RT_USE_MMAP
+extern void WASM_RT_ADD_PREFIX(init_instance_from_snapshot)(WASM_RT_ADD_PREFIX(instance_t)*, const wasm_rt_memory_snapshot_t*);
+extern u64 WASM_RT_ADD_PREFIX(reset_instance_from_snapshot)(WASM_RT_ADD_PREFIX(instance_t)*, const wasm_rt_memory_snapshot_t*);
+#endif
+extern void WASM_RT_ADD_PREFIX(free_instance)(WASM_RT_ADD_PREFIX(instance_t)*);
 
 /* export: 'memory' */
-extern wasm_rt_memory_t (*WASM_RT_ADD_PREFIX(Z_memory));
+extern wasm_rt_memory_t* WASM_RT_ADD_PREFIX(Z_memory)(WASM_RT_ADD_PREFIX(instance_t)*);
 /* export: '__alloc' */
-extern u32 (*WASM_RT_ADD_PREFIX(Z___allocZ_iii))(u32, u32);
+extern u32 WASM_RT_ADD_PREFIX(Z___allocZ_iii)(WASM_RT_ADD_PREFIX(instance_t)*, u32, u32);
 /* export: '__retain' */
-extern u32 (*WASM_RT_ADD_PREFIX(Z___retainZ_ii))(u32);
+extern u32 WASM_RT_ADD_PREFIX(Z___retainZ_ii)(WASM_RT_ADD_PREFIX(instance_t)*, u32);
 /* export: '__release' */
-extern void (*WASM_RT_ADD_PREFIX(Z___releaseZ_vi))(u32);
+extern void WASM_RT_ADD_PREFIX(Z___releaseZ_vi)(WASM_RT_ADD_PREFIX(instance_t)*, u32);
 /* export: '__collect' */
-extern void (*WASM_RT_ADD_PREFIX(Z___collectZ_vv))(void);
+extern void WASM_RT_ADD_PREFIX(Z___collectZ_vv)(WASM_RT_ADD_PREFIX(instance_t)*);
 /* export: '__rtti_base' */
-extern u32 (*WASM_RT_ADD_PREFIX(Z___rtti_baseZ_i));
+extern u32* WASM_RT_ADD_PREFIX(Z___rtti_baseZ_i)(WASM_RT_ADD_PREFIX(instance_t)*);
 /* export: 'loadAndIncrement' */
-extern u32 (*WASM_RT_ADD_PREFIX(Z_loadAndIncrementZ_ii))(u32);
+extern u32 WASM_RT_ADD_PREFIX(Z_loadAndIncrementZ_ii)(WASM_RT_ADD_PREFIX(instance_t)*, u32);
 #ifdef __cplusplus
 }
 #endif
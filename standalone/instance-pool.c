@@ -0,0 +1,99 @@
+#include "instance-pool.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct instance_pool_t {
+  instance_pool_module_t module;
+  pthread_mutex_t mutex;
+  /* Stack of idle instances, so the most recently used (and so most likely
+   * cached) one is handed out next. */
+  void** idle;
+  uint32_t idle_count;
+  uint32_t max_idle;
+  instance_pool_stats_t stats;
+};
+
+static void* new_instance(instance_pool_t* pool) {
+  void* instance = malloc(pool->module.instance_size);
+  if (instance == NULL) {
+    perror("failed to allocate instance");
+    abort();
+  }
+  pool->module.init(pool->module.context, instance);
+  return instance;
+}
+
+instance_pool_t* instance_pool_create(const instance_pool_module_t* module,
+                                      uint32_t prewarm,
+                                      uint32_t max_idle) {
+  instance_pool_t* pool = calloc(1, sizeof(instance_pool_t));
+  if (pool == NULL || (pool->idle = calloc(max_idle, sizeof(void*))) == NULL) {
+    perror("failed to allocate instance pool");
+    abort();
+  }
+  pool->module = *module;
+  pool->max_idle = max_idle;
+  pthread_mutex_init(&pool->mutex, NULL);
+  if (prewarm > max_idle) {
+    prewarm = max_idle;
+  }
+  while (pool->idle_count < prewarm) {
+    pool->idle[pool->idle_count++] = new_instance(pool);
+  }
+  return pool;
+}
+
+void* instance_pool_acquire(instance_pool_t* pool) {
+  void* instance = NULL;
+  pthread_mutex_lock(&pool->mutex);
+  if (pool->idle_count > 0) {
+    instance = pool->idle[--pool->idle_count];
+    ++pool->stats.hits;
+  } else {
+    ++pool->stats.misses;
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return instance ? instance : new_instance(pool);
+}
+
+void instance_pool_release(instance_pool_t* pool, void* instance) {
+  /* Reset before taking the lock: it is the expensive part, and the instance
+   * is not shared until it is back on the stack. */
+  uint64_t reset_size = pool->module.reset(pool->module.context, instance);
+  int kept = 0;
+
+  pthread_mutex_lock(&pool->mutex);
+  ++pool->stats.resets;
+  pool->stats.bytes_reset += reset_size;
+  if (pool->idle_count < pool->max_idle) {
+    pool->idle[pool->idle_count++] = instance;
+    kept = 1;
+  }
+  pthread_mutex_unlock(&pool->mutex);
+
+  if (!kept) {
+    pool->module.free(pool->module.context, instance);
+    free(instance);
+  }
+}
+
+void instance_pool_get_stats(instance_pool_t* pool,
+                             instance_pool_stats_t* stats) {
+  pthread_mutex_lock(&pool->mutex);
+  *stats = pool->stats;
+  stats->idle = pool->idle_count;
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+void instance_pool_destroy(instance_pool_t* pool) {
+  while (pool->idle_count > 0) {
+    void* instance = pool->idle[--pool->idle_count];
+    pool->module.free(pool->module.context, instance);
+    free(instance);
+  }
+  pthread_mutex_destroy(&pool->mutex);
+  free(pool->idle);
+  free(pool);
+}
@@ -0,0 +1,71 @@
+/* A pool of ready-to-use module instances, for running each request in a
+ * fresh instance without paying for `init_instance` every time.
+ *
+ * Released instances are reset and kept for the next `instance_pool_acquire`
+ * rather than freed, so their memory and tables are reused and only the pages
+ * a request dirtied have to be cleared. The pool is safe to share between
+ * threads.
+ */
+#ifndef INSTANCE_POOL_H_
+#define INSTANCE_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** How the pool manages instances of one module. Modules differ in their
+ * instance type, so this is a set of thin wrappers around the generated
+ * `init_instance`, `reset_instance` and `free_instance` (or their snapshot
+ * variants, with the snapshot as `context`). */
+typedef struct {
+  size_t instance_size;
+  void* context;
+  void (*init)(void* context, void* instance);
+  /** Returns the number of bytes of memory that had to be reset. */
+  uint64_t (*reset)(void* context, void* instance);
+  void (*free)(void* context, void* instance);
+} instance_pool_module_t;
+
+typedef struct {
+  /** Acquires served by an idle instance. */
+  uint64_t hits;
+  /** Acquires that had to initialize a new instance. */
+  uint64_t misses;
+  /** Instances reset on release. */
+  uint64_t resets;
+  /** Bytes of memory reset, over all resets. */
+  uint64_t bytes_reset;
+  /** Instances currently idle in the pool. */
+  uint32_t idle;
+} instance_pool_stats_t;
+
+typedef struct instance_pool_t instance_pool_t;
+
+/** Create a pool holding up to `max_idle` idle instances, `prewarm` of which
+ * are initialized up front. */
+instance_pool_t* instance_pool_create(const instance_pool_module_t*,
+                                      uint32_t prewarm,
+                                      uint32_t max_idle);
+
+/** Take an instance out of the pool, initializing a new one if none is idle.
+ * It is in the same state as after `init_instance`. */
+void* instance_pool_acquire(instance_pool_t*);
+
+/** Reset `instance` and return it to the pool, or free it if the pool already
+ * holds `max_idle` instances. */
+void instance_pool_release(instance_pool_t*, void* instance);
+
+void instance_pool_get_stats(instance_pool_t*, instance_pool_stats_t*);
+
+/** Free the pool and its idle instances. Instances still acquired must be
+ * released first. */
+void instance_pool_destroy(instance_pool_t*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INSTANCE_POOL_H_ */
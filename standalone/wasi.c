@@ -0,0 +1,952 @@
+#define _GNU_SOURCE
+#include "wasi.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Set to 0 to always walk paths a directory at a time, as on kernels without
+ * openat2, so that the tests can check that path too. */
+#ifndef WASI_USE_OPENAT2
+#define WASI_USE_OPENAT2 1
+#endif
+
+#if WASI_USE_OPENAT2 && defined(SYS_openat2) && defined(__has_include)
+#if __has_include(<linux/openat2.h>)
+#include <linux/openat2.h>
+#define WASI_HAVE_OPENAT2 1
+#endif
+#endif
+
+/* Iovecs handled per call; a longer list gets a short read or write, which
+ * callers must be prepared for anyway. */
+#define WASI_MAX_IOVS 64
+
+/* A guest iovec: u32 buf, u32 buf_len. */
+#define WASI_IOVEC_SIZE 8
+
+/* Error codes, the same in wasi_unstable and wasi_snapshot_preview1. */
+#define WASI_ESUCCESS 0
+#define WASI_E2BIG 1
+#define WASI_EACCES 2
+#define WASI_EAGAIN 6
+#define WASI_EBADF 8
+#define WASI_EEXIST 20
+#define WASI_EFAULT 21
+#define WASI_EINTR 27
+#define WASI_EINVAL 28
+#define WASI_EIO 29
+#define WASI_EISDIR 31
+#define WASI_ELOOP 32
+#define WASI_EMFILE 33
+#define WASI_ENAMETOOLONG 37
+#define WASI_ENOENT 44
+#define WASI_ENOMEM 48
+#define WASI_ENOSPC 51
+#define WASI_ENOSYS 52
+#define WASI_ENOTDIR 54
+#define WASI_ENOTEMPTY 55
+#define WASI_ENOTSUP 58
+#define WASI_EPERM 63
+#define WASI_EPIPE 64
+#define WASI_ESPIPE 70
+#define WASI_ENOTCAPABLE 76
+
+#define WASI_FILETYPE_UNKNOWN 0
+#define WASI_FILETYPE_BLOCK_DEVICE 1
+#define WASI_FILETYPE_CHARACTER_DEVICE 2
+#define WASI_FILETYPE_DIRECTORY 3
+#define WASI_FILETYPE_REGULAR_FILE 4
+#define WASI_FILETYPE_SOCKET_STREAM 6
+#define WASI_FILETYPE_SYMBOLIC_LINK 7
+
+#define WASI_FDFLAG_APPEND 1
+#define WASI_FDFLAG_DSYNC 2
+#define WASI_FDFLAG_NONBLOCK 4
+#define WASI_FDFLAG_SYNC 16
+
+#define WASI_OFLAG_CREAT 1
+#define WASI_OFLAG_DIRECTORY 2
+#define WASI_OFLAG_EXCL 4
+#define WASI_OFLAG_TRUNC 8
+
+#define WASI_LOOKUP_SYMLINK_FOLLOW 1
+
+#define WASI_RIGHT_FD_READ (1ull << 1)
+#define WASI_RIGHT_FD_WRITE (1ull << 6)
+
+#define WASI_WHENCE_SET 0
+#define WASI_WHENCE_CUR 1
+#define WASI_WHENCE_END 2
+
+#define WASI_CLOCK_REALTIME 0
+#define WASI_CLOCK_MONOTONIC 1
+#define WASI_CLOCK_PROCESS_CPUTIME 2
+#define WASI_CLOCK_THREAD_CPUTIME 3
+
+static uint32_t errno_to_wasi(int error) {
+  switch (error) {
+    case E2BIG: return WASI_E2BIG;
+    case EACCES: return WASI_EACCES;
+    case EAGAIN: return WASI_EAGAIN;
+    case EBADF: return WASI_EBADF;
+    case EEXIST: return WASI_EEXIST;
+    case EFAULT: return WASI_EFAULT;
+    case EINTR: return WASI_EINTR;
+    case EINVAL: return WASI_EINVAL;
+    case EISDIR: return WASI_EISDIR;
+    case ELOOP: return WASI_ELOOP;
+    case EMFILE: return WASI_EMFILE;
+    case ENAMETOOLONG: return WASI_ENAMETOOLONG;
+    case ENOENT: return WASI_ENOENT;
+    case ENOMEM: return WASI_ENOMEM;
+    case ENOSPC: return WASI_ENOSPC;
+    case ENOSYS: return WASI_ENOSYS;
+    case ENOTDIR: return WASI_ENOTDIR;
+    case ENOTEMPTY: return WASI_ENOTEMPTY;
+    case ENOTSUP: return WASI_ENOTSUP;
+    case EPERM: return WASI_EPERM;
+    case EPIPE: return WASI_EPIPE;
+    case ESPIPE: return WASI_ESPIPE;
+    /* What openat2 reports for a path that leads out of its directory. */
+    case EXDEV: return WASI_ENOTCAPABLE;
+    default: return WASI_EIO;
+  }
+}
+
+/* Whether `size` bytes at `ptr` are inside linear memory. */
+static int in_memory(const wasi_t* wasi, uint32_t ptr, uint64_t size) {
+  return (uint64_t)ptr + size <= wasi->memory->size;
+}
+
+static uint32_t load_u32(const wasi_t* wasi, uint32_t ptr) {
+  uint32_t value;
+  memcpy(&value, wasi->memory->data + ptr, sizeof(value));
+  return value;
+}
+
+static void store_u32(wasi_t* wasi, uint32_t ptr, uint32_t value) {
+  memcpy(wasi->memory->data + ptr, &value, sizeof(value));
+}
+
+static void store_u64(wasi_t* wasi, uint32_t ptr, uint64_t value) {
+  memcpy(wasi->memory->data + ptr, &value, sizeof(value));
+}
+
+static uint64_t monotonic_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+static wasi_fd_t* get_fd(wasi_t* wasi, uint32_t fd) {
+  if (fd >= wasi->fd_count || wasi->fds[fd].host_fd < 0) {
+    return NULL;
+  }
+  return &wasi->fds[fd];
+}
+
+/* Returns the new descriptor, or -1 if out of memory. */
+static int add_fd(wasi_t* wasi, int host_fd, const char* preopen_path) {
+  uint32_t fd;
+  for (fd = 0; fd < wasi->fd_count; ++fd) {
+    if (wasi->fds[fd].host_fd < 0) {
+      break;
+    }
+  }
+  if (fd == wasi->fd_capacity) {
+    uint32_t capacity = wasi->fd_capacity ? wasi->fd_capacity * 2 : 8;
+    wasi_fd_t* fds = realloc(wasi->fds, capacity * sizeof(wasi_fd_t));
+    if (fds == NULL) {
+      return -1;
+    }
+    wasi->fds = fds;
+    wasi->fd_capacity = capacity;
+  }
+  wasi->fds[fd].host_fd = host_fd;
+  wasi->fds[fd].preopen_path = NULL;
+  if (preopen_path && !(wasi->fds[fd].preopen_path = strdup(preopen_path))) {
+    wasi->fds[fd].host_fd = -1;
+    return -1;
+  }
+  if (fd == wasi->fd_count) {
+    ++wasi->fd_count;
+  }
+  return (int)fd;
+}
+
+/* The ring buffering writes to the host's stdout or stderr through `entry`,
+ * if any. */
+static wasi_output_t* get_output(wasi_t* wasi, const wasi_fd_t* entry) {
+  wasi_output_t* output;
+  if (entry->host_fd != 1 && entry->host_fd != 2) {
+    return NULL;
+  }
+  output = &wasi->output[entry->host_fd - 1];
+  return output->data ? output : NULL;
+}
+
+/* Write out the ring to `host_fd`, as much as it takes. What a non-blocking
+ * descriptor does not take yet stays buffered; on any other error the output
+ * is dropped. */
+static void flush_output(wasi_output_t* output, int host_fd) {
+  uint64_t begin, elapsed;
+  if (output->length == 0) {
+    return;
+  }
+  begin = monotonic_ns();
+  while (output->length > 0) {
+    struct iovec host[2];
+    uint32_t first = output->capacity - output->start;
+    int count = 1;
+    ssize_t n;
+    host[0].iov_base = output->data + output->start;
+    if (first >= output->length) {
+      host[0].iov_len = output->length;
+    } else {
+      host[0].iov_len = first;
+      host[1].iov_base = output->data;
+      host[1].iov_len = output->length - first;
+      count = 2;
+    }
+    n = writev(host_fd, host, count);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        output->dropped_bytes += output->length;
+        output->length = 0;
+      }
+      break;
+    }
+    output->start = (output->start + (uint32_t)n) % output->capacity;
+    output->length -= (uint32_t)n;
+    output->flushed_bytes += (uint64_t)n;
+  }
+  if (output->length == 0) {
+    output->start = 0;
+  }
+  elapsed = monotonic_ns() - begin;
+  ++output->flushes;
+  output->flush_ns += elapsed;
+  if (elapsed > output->max_flush_ns) {
+    output->max_flush_ns = elapsed;
+  }
+}
+
+/* Add as much of the `count` buffers at `host` to the ring as fits, flushing
+ * it first if they don't, and set `written` to how much that was. That is
+ * short of their size, or 0, when a non-blocking descriptor has not taken
+ * enough of the ring yet. Returns 0 if they are better written directly: they
+ * do not fit even in the empty ring. */
+static int buffer_output(wasi_output_t* output, int host_fd,
+                         const struct iovec* host, int count,
+                         uint32_t* written) {
+  uint64_t total = 0, remaining;
+  int i;
+  for (i = 0; i < count; ++i) {
+    total += host[i].iov_len;
+  }
+  if (total > output->capacity - output->length) {
+    flush_output(output, host_fd);
+    if (output->length == 0 && total > output->capacity) {
+      return 0;
+    }
+  }
+  ++output->writes;
+  if (total > output->capacity - output->length) {
+    total = output->capacity - output->length;
+  }
+  *written = (uint32_t)total;
+  remaining = total;
+  for (i = 0; i < count && remaining > 0; ++i) {
+    const char* bytes = host[i].iov_base;
+    size_t left = host[i].iov_len < remaining ? host[i].iov_len : remaining;
+    remaining -= left;
+    while (left > 0) {
+      uint32_t end = (output->start + output->length) % output->capacity;
+      size_t chunk = output->capacity - end;
+      if (chunk > left) {
+        chunk = left;
+      }
+      memcpy(output->data + end, bytes, chunk);
+      output->length += (uint32_t)chunk;
+      bytes += chunk;
+      left -= chunk;
+    }
+  }
+  if (output->length >= output->flush_bytes) {
+    flush_output(output, host_fd);
+  }
+  return 1;
+}
+
+int wasi_init(wasi_t* wasi, wasm_rt_memory_t* memory, int argc, char** argv,
+              char** envp) {
+  int fd;
+  memset(wasi, 0, sizeof(*wasi));
+  wasi->memory = memory;
+  wasi->argc = argc;
+  wasi->argv = argv;
+  wasi->envp = envp;
+  for (fd = 0; fd < 3; ++fd) {
+    if (add_fd(wasi, fd, NULL) < 0) {
+      wasi_free(wasi);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int wasi_preopen(wasi_t* wasi, const char* host_path, const char* guest_path) {
+  int fd;
+  int host_fd = open(host_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (host_fd < 0) {
+    return -1;
+  }
+  fd = add_fd(wasi, host_fd, guest_path);
+  if (fd < 0) {
+    close(host_fd);
+    errno = ENOMEM;
+  }
+  return fd;
+}
+
+int wasi_buffer_output(wasi_t* wasi, uint32_t capacity, uint32_t flush_bytes) {
+  int i;
+  if (capacity == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  for (i = 0; i < 2; ++i) {
+    wasi_output_t* output = &wasi->output[i];
+    char* data;
+    if (output->data) {
+      flush_output(output, i + 1);
+    }
+    data = realloc(output->data, capacity);
+    if (data == NULL) {
+      return -1;
+    }
+    memset(output, 0, sizeof(*output));
+    output->data = data;
+    output->capacity = capacity;
+    output->flush_bytes = flush_bytes < capacity ? flush_bytes : capacity;
+  }
+  return 0;
+}
+
+void wasi_flush(wasi_t* wasi) {
+  int i;
+  for (i = 0; i < 2; ++i) {
+    if (wasi->output[i].data) {
+      flush_output(&wasi->output[i], i + 1);
+    }
+  }
+}
+
+void wasi_free(wasi_t* wasi) {
+  uint32_t fd;
+  int i;
+  wasi_flush(wasi);
+  for (i = 0; i < 2; ++i) {
+    free(wasi->output[i].data);
+    wasi->output[i].data = NULL;
+  }
+  for (fd = 0; fd < wasi->fd_count; ++fd) {
+    if (fd > 2 && wasi->fds[fd].host_fd >= 0) {
+      close(wasi->fds[fd].host_fd);
+    }
+    free(wasi->fds[fd].preopen_path);
+  }
+  free(wasi->fds);
+  wasi->fds = NULL;
+  wasi->fd_count = wasi->fd_capacity = 0;
+}
+
+/* Sizes and copies a NULL-terminated list of strings for args_*_get and
+ * environ_*_get. */
+static uint32_t strings_sizes_get(wasi_t* wasi, char** strings, uint32_t count,
+                                  uint32_t count_ptr, uint32_t size_ptr) {
+  uint64_t size = 0;
+  uint32_t i;
+  if (!in_memory(wasi, count_ptr, 4) || !in_memory(wasi, size_ptr, 4)) {
+    return WASI_EFAULT;
+  }
+  for (i = 0; i < count; ++i) {
+    size += strlen(strings[i]) + 1;
+  }
+  if (size > UINT32_MAX) {
+    return WASI_E2BIG;
+  }
+  store_u32(wasi, count_ptr, count);
+  store_u32(wasi, size_ptr, (uint32_t)size);
+  return WASI_ESUCCESS;
+}
+
+static uint32_t strings_get(wasi_t* wasi, char** strings, uint32_t count,
+                            uint32_t ptrs, uint32_t buf) {
+  uint32_t i;
+  if (!in_memory(wasi, ptrs, (uint64_t)count * 4)) {
+    return WASI_EFAULT;
+  }
+  for (i = 0; i < count; ++i) {
+    size_t size = strlen(strings[i]) + 1;
+    if (!in_memory(wasi, buf, size)) {
+      return WASI_EFAULT;
+    }
+    memcpy(wasi->memory->data + buf, strings[i], size);
+    store_u32(wasi, ptrs + i * 4, buf);
+    buf += (uint32_t)size;
+  }
+  return WASI_ESUCCESS;
+}
+
+static uint32_t count_strings(char** strings) {
+  uint32_t count = 0;
+  while (strings && strings[count]) {
+    ++count;
+  }
+  return count;
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_args_getZ_iii(wasi_t* wasi, uint32_t argv,
+                                                 uint32_t argv_buf) {
+  return strings_get(wasi, wasi->argv, wasi->argc, argv, argv_buf);
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_args_sizes_getZ_iii(
+    wasi_t* wasi, uint32_t argc, uint32_t argv_buf_size) {
+  return strings_sizes_get(wasi, wasi->argv, wasi->argc, argc, argv_buf_size);
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_environ_getZ_iii(wasi_t* wasi,
+                                                    uint32_t environ,
+                                                    uint32_t environ_buf) {
+  return strings_get(wasi, wasi->envp, count_strings(wasi->envp), environ,
+                     environ_buf);
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_environ_sizes_getZ_iii(
+    wasi_t* wasi, uint32_t environ_count, uint32_t environ_buf_size) {
+  return strings_sizes_get(wasi, wasi->envp, count_strings(wasi->envp),
+                           environ_count, environ_buf_size);
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_clock_time_getZ_iiji(wasi_t* wasi,
+                                                        uint32_t clock_id,
+                                                        uint64_t precision,
+                                                        uint32_t time) {
+  struct timespec now;
+  clockid_t host_clock;
+  (void)precision;
+  switch (clock_id) {
+    case WASI_CLOCK_REALTIME: host_clock = CLOCK_REALTIME; break;
+    case WASI_CLOCK_MONOTONIC: host_clock = CLOCK_MONOTONIC; break;
+    case WASI_CLOCK_PROCESS_CPUTIME: host_clock = CLOCK_PROCESS_CPUTIME_ID;
+      break;
+    case WASI_CLOCK_THREAD_CPUTIME: host_clock = CLOCK_THREAD_CPUTIME_ID; break;
+    default: return WASI_EINVAL;
+  }
+  if (!in_memory(wasi, time, 8)) {
+    return WASI_EFAULT;
+  }
+  if (clock_gettime(host_clock, &now) != 0) {
+    return errno_to_wasi(errno);
+  }
+  store_u64(wasi, time, (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec);
+  return WASI_ESUCCESS;
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_fd_closeZ_ii(wasi_t* wasi, uint32_t fd) {
+  wasi_fd_t* entry = get_fd(wasi, fd);
+  wasi_output_t* output;
+  if (!entry) {
+    return WASI_EBADF;
+  }
+  output = get_output(wasi, entry);
+  if (output) {
+    flush_output(output, entry->host_fd);
+  }
+  /* Keep the host's standard streams open for the host. */
+  if (fd > 2 && close(entry->host_fd) != 0 && errno != EINTR) {
+    return errno_to_wasi(errno);
+  }
+  entry->host_fd = -1;
+  free(entry->preopen_path);
+  entry->preopen_path = NULL;
+  return WASI_ESUCCESS;
+}
+
+static uint8_t mode_to_filetype(mode_t mode) {
+  switch (mode & S_IFMT) {
+    case S_IFBLK: return WASI_FILETYPE_BLOCK_DEVICE;
+    case S_IFCHR: return WASI_FILETYPE_CHARACTER_DEVICE;
+    case S_IFDIR: return WASI_FILETYPE_DIRECTORY;
+    case S_IFREG: return WASI_FILETYPE_REGULAR_FILE;
+    case S_IFSOCK: return WASI_FILETYPE_SOCKET_STREAM;
+    case S_IFLNK: return WASI_FILETYPE_SYMBOLIC_LINK;
+    default: return WASI_FILETYPE_UNKNOWN;
+  }
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_fd_fdstat_getZ_iii(wasi_t* wasi,
+                                                      uint32_t fd,
+                                                      uint32_t stat) {
+  wasi_fd_t* entry = get_fd(wasi, fd);
+  struct stat host_stat;
+  uint16_t flags = 0;
+  uint8_t filetype;
+  int host_flags;
+  if (!entry) {
+    return WASI_EBADF;
+  }
+  if (!in_memory(wasi, stat, 24)) {
+    return WASI_EFAULT;
+  }
+  if (fstat(entry->host_fd, &host_stat) != 0 ||
+      (host_flags = fcntl(entry->host_fd, F_GETFL)) < 0) {
+    return errno_to_wasi(errno);
+  }
+  if (host_flags & O_APPEND) flags |= WASI_FDFLAG_APPEND;
+  if (host_flags & O_DSYNC) flags |= WASI_FDFLAG_DSYNC;
+  if (host_flags & O_NONBLOCK) flags |= WASI_FDFLAG_NONBLOCK;
+  if ((host_flags & O_SYNC) == O_SYNC) flags |= WASI_FDFLAG_SYNC;
+  filetype = mode_to_filetype(host_stat.st_mode);
+
+  /* u8 filetype, u16 flags at 2, u64 rights base at 8 and inheriting at 16.
+   * Rights are not tracked, so every one is reported. */
+  memset(wasi->memory->data + stat, 0, 24);
+  wasi->memory->data[stat] = filetype;
+  memcpy(wasi->memory->data + stat + 2, &flags, sizeof(flags));
+  store_u64(wasi, stat + 8, UINT64_MAX);
+  store_u64(wasi, stat + 16, UINT64_MAX);
+  return WASI_ESUCCESS;
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_fd_prestat_getZ_iii(wasi_t* wasi,
+                                                       uint32_t fd,
+                                                       uint32_t prestat) {
+  wasi_fd_t* entry = get_fd(wasi, fd);
+  if (!entry || !entry->preopen_path) {
+    return WASI_EBADF;
+  }
+  if (!in_memory(wasi, prestat, 8)) {
+    return WASI_EFAULT;
+  }
+  /* u8 tag 0 (a directory), then its u32 name length at 4. */
+  store_u32(wasi, prestat, 0);
+  store_u32(wasi, prestat + 4, (uint32_t)strlen(entry->preopen_path));
+  return WASI_ESUCCESS;
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_fd_prestat_dir_nameZ_iiii(
+    wasi_t* wasi, uint32_t fd, uint32_t path, uint32_t path_len) {
+  wasi_fd_t* entry = get_fd(wasi, fd);
+  size_t length;
+  if (!entry || !entry->preopen_path) {
+    return WASI_EBADF;
+  }
+  length = strlen(entry->preopen_path);
+  if (path_len < length) {
+    return WASI_ENAMETOOLONG;
+  }
+  if (!in_memory(wasi, path, length)) {
+    return WASI_EFAULT;
+  }
+  memcpy(wasi->memory->data + path, entry->preopen_path, length);
+  return WASI_ESUCCESS;
+}
+
+/* Point `host` at the buffers of the guest iovecs at `iovs`, in place.
+ * Returns how many were translated, or -1 if any is outside of memory. */
+static int translate_iovecs(wasi_t* wasi, uint32_t iovs, uint32_t iovs_len,
+                            struct iovec* host) {
+  uint32_t i;
+  if (iovs_len > WASI_MAX_IOVS) {
+    iovs_len = WASI_MAX_IOVS;
+  }
+  if (!in_memory(wasi, iovs, (uint64_t)iovs_len * WASI_IOVEC_SIZE)) {
+    return -1;
+  }
+  for (i = 0; i < iovs_len; ++i) {
+    uint32_t buf = load_u32(wasi, iovs + i * WASI_IOVEC_SIZE);
+    uint32_t buf_len = load_u32(wasi, iovs + i * WASI_IOVEC_SIZE + 4);
+    if (!in_memory(wasi, buf, buf_len)) {
+      return -1;
+    }
+    host[i].iov_base = wasi->memory->data + buf;
+    host[i].iov_len = buf_len;
+  }
+  return (int)iovs_len;
+}
+
+/* One readv or writev over the guest iovecs, storing the byte count at
+ * `result`. */
+static uint32_t transfer(wasi_t* wasi, uint32_t fd, uint32_t iovs,
+                         uint32_t iovs_len, uint32_t result, int write) {
+  struct iovec host[WASI_MAX_IOVS];
+  wasi_fd_t* entry = get_fd(wasi, fd);
+  wasi_output_t* output;
+  uint32_t written;
+  ssize_t n;
+  int count;
+  if (!entry) {
+    return WASI_EBADF;
+  }
+  count = translate_iovecs(wasi, iovs, iovs_len, host);
+  if (count < 0 || !in_memory(wasi, result, 4)) {
+    return WASI_EFAULT;
+  }
+  if (write && (output = get_output(wasi, entry)) != NULL) {
+    while (buffer_output(output, entry->host_fd, host, count, &written)) {
+      if (written > 0) {
+        store_u32(wasi, result, written);
+        return WASI_ESUCCESS;
+      }
+      /* The ring is full of output the descriptor has not taken yet. */
+      if (!wasi->wait_fd ||
+          wasi->wait_fd(wasi->wait_context, entry->host_fd, EPOLLOUT) < 0) {
+        return WASI_EAGAIN;
+      }
+    }
+  }
+  for (;;) {
+    n = write ? writev(entry->host_fd, host, count)
+              : readv(entry->host_fd, host, count);
+    if (n >= 0) {
+      break;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if ((errno != EAGAIN && errno != EWOULDBLOCK) || !wasi->wait_fd ||
+        wasi->wait_fd(wasi->wait_context, entry->host_fd,
+                      write ? EPOLLOUT : EPOLLIN) < 0) {
+      return errno_to_wasi(errno);
+    }
+  }
+  store_u32(wasi, result, (uint32_t)n);
+  return WASI_ESUCCESS;
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_fd_readZ_iiiii(wasi_t* wasi, uint32_t fd,
+                                                  uint32_t iovs,
+                                                  uint32_t iovs_len,
+                                                  uint32_t nread) {
+  return transfer(wasi, fd, iovs, iovs_len, nread, 0);
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_fd_writeZ_iiiii(wasi_t* wasi, uint32_t fd,
+                                                   uint32_t iovs,
+                                                   uint32_t iovs_len,
+                                                   uint32_t nwritten) {
+  return transfer(wasi, fd, iovs, iovs_len, nwritten, 1);
+}
+
+static uint32_t seek(wasi_t* wasi, uint32_t fd, uint64_t offset, int whence,
+                     uint32_t newoffset) {
+  wasi_fd_t* entry = get_fd(wasi, fd);
+  off_t position;
+  if (!entry) {
+    return WASI_EBADF;
+  }
+  if (!in_memory(wasi, newoffset, 8)) {
+    return WASI_EFAULT;
+  }
+  position = lseek(entry->host_fd, (off_t)(int64_t)offset, whence);
+  if (position < 0) {
+    return errno_to_wasi(errno);
+  }
+  store_u64(wasi, newoffset, (uint64_t)position);
+  return WASI_ESUCCESS;
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_fd_seekZ_iijii(wasi_t* wasi, uint32_t fd,
+                                                  uint64_t offset,
+                                                  uint32_t whence,
+                                                  uint32_t newoffset) {
+  switch (whence) {
+    case WASI_WHENCE_SET: return seek(wasi, fd, offset, SEEK_SET, newoffset);
+    case WASI_WHENCE_CUR: return seek(wasi, fd, offset, SEEK_CUR, newoffset);
+    case WASI_WHENCE_END: return seek(wasi, fd, offset, SEEK_END, newoffset);
+    default: return WASI_EINVAL;
+  }
+}
+
+/* Whether `path` stays inside the directory it is relative to. */
+static int is_contained(const char* path, size_t length) {
+  size_t start = 0, i;
+  if (length == 0 || path[0] == '/' || memchr(path, 0, length)) {
+    return 0;
+  }
+  for (i = 0; i <= length; ++i) {
+    if (i == length || path[i] == '/') {
+      if (i - start == 2 && path[start] == '.' && path[start + 1] == '.') {
+        return 0;
+      }
+      start = i + 1;
+    }
+  }
+  return 1;
+}
+
+/* Open `path` under the directory `dir_fd` without leaving it, through ".."
+ * or through a symlink anywhere along the path. openat2 checks this in the
+ * kernel, following symlinks that stay inside if `follow` is set. Without it,
+ * the path is walked a directory at a time with O_NOFOLLOW, so no symlink is
+ * followed at all. Returns the descriptor, or -1 with errno set. */
+static int open_beneath(int dir_fd, char* path, int flags, int follow) {
+  char* component;
+  char* next;
+  int fd, child_fd;
+#ifdef WASI_HAVE_OPENAT2
+  struct open_how how;
+  memset(&how, 0, sizeof(how));
+  how.flags = (uint64_t)(flags | (follow ? 0 : O_NOFOLLOW));
+  how.mode = (flags & O_CREAT) ? 0666 : 0;
+  how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+  fd = (int)syscall(SYS_openat2, dir_fd, path, &how, sizeof(how));
+  /* Older container seccomp profiles refuse syscalls they do not know with
+   * EPERM; walking the path is stricter, so it is safe to retry that way. */
+  if (fd >= 0 || (errno != ENOSYS && errno != EPERM)) {
+    return fd;
+  }
+#else
+  (void)follow;
+#endif
+  fd = dir_fd;
+  for (component = path; (next = strchr(component, '/')) != NULL;
+       component = next + 1) {
+    *next = '\0';
+    if (*component == '\0') {
+      continue;
+    }
+    child_fd = openat(fd, component,
+                      O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd != dir_fd) {
+      close(fd);
+    }
+    if (child_fd < 0) {
+      return -1;
+    }
+    fd = child_fd;
+  }
+  /* A trailing slash leaves the directory reached itself to open. */
+  child_fd = openat(fd, *component ? component : ".", flags | O_NOFOLLOW,
+                    0666);
+  if (fd != dir_fd) {
+    close(fd);
+  }
+  return child_fd;
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_path_openZ_iiiiiijjii(
+    wasi_t* wasi, uint32_t dirfd, uint32_t dirflags, uint32_t path,
+    uint32_t path_len, uint32_t oflags, uint64_t fs_rights_base,
+    uint64_t fs_rights_inheriting, uint32_t fdflags, uint32_t fd) {
+  wasi_fd_t* dir = get_fd(wasi, dirfd);
+  int flags = O_CLOEXEC, host_fd, new_fd;
+  int read = (fs_rights_base & WASI_RIGHT_FD_READ) != 0;
+  int write = (fs_rights_base & WASI_RIGHT_FD_WRITE) != 0;
+  const char* guest_path;
+  char* host_path;
+  (void)fs_rights_inheriting;
+  if (!dir) {
+    return WASI_EBADF;
+  }
+  if (!in_memory(wasi, path, path_len) || !in_memory(wasi, fd, 4)) {
+    return WASI_EFAULT;
+  }
+  guest_path = (const char*)wasi->memory->data + path;
+  /* Some toolchains pass absolute paths along with the preopen they fall
+   * under; take those relative to it. */
+  if (dir->preopen_path && dir->preopen_path[0] == '/') {
+    size_t prefix = strlen(dir->preopen_path);
+    while (prefix > 0 && dir->preopen_path[prefix - 1] == '/') {
+      --prefix;
+    }
+    if (path_len > prefix + 1 &&
+        memcmp(guest_path, dir->preopen_path, prefix) == 0 &&
+        guest_path[prefix] == '/') {
+      guest_path += prefix + 1;
+      path_len -= prefix + 1;
+    }
+  }
+  if (!is_contained(guest_path, path_len)) {
+    return WASI_ENOTCAPABLE;
+  }
+
+  flags |= write ? (read ? O_RDWR : O_WRONLY) : O_RDONLY;
+  if (oflags & WASI_OFLAG_CREAT) flags |= O_CREAT;
+  if (oflags & WASI_OFLAG_DIRECTORY) flags |= O_DIRECTORY;
+  if (oflags & WASI_OFLAG_EXCL) flags |= O_EXCL;
+  if (oflags & WASI_OFLAG_TRUNC) flags |= O_TRUNC;
+  if (fdflags & WASI_FDFLAG_APPEND) flags |= O_APPEND;
+  if (fdflags & WASI_FDFLAG_DSYNC) flags |= O_DSYNC;
+  if (fdflags & WASI_FDFLAG_NONBLOCK) flags |= O_NONBLOCK;
+  if (fdflags & WASI_FDFLAG_SYNC) flags |= O_SYNC;
+
+  host_path = strndup(guest_path, path_len);
+  if (!host_path) {
+    return WASI_ENOMEM;
+  }
+  host_fd = open_beneath(dir->host_fd, host_path, flags,
+                         (dirflags & WASI_LOOKUP_SYMLINK_FOLLOW) != 0);
+  free(host_path);
+  if (host_fd < 0) {
+    return errno_to_wasi(errno);
+  }
+  new_fd = add_fd(wasi, host_fd, NULL);
+  if (new_fd < 0) {
+    close(host_fd);
+    return WASI_ENOMEM;
+  }
+  store_u32(wasi, fd, (uint32_t)new_fd);
+  return WASI_ESUCCESS;
+}
+
+void Z_wasi_snapshot_preview1Z_proc_exitZ_vi(wasi_t* wasi, uint32_t code) {
+  wasi->exit_code = code;
+  wasi_flush(wasi);
+  wasm_rt_trap(WASM_RT_TRAP_EXIT);
+}
+
+uint32_t Z_wasi_snapshot_preview1Z_random_getZ_iii(wasi_t* wasi, uint32_t buf,
+                                                   uint32_t buf_len) {
+  uint32_t filled = 0;
+  if (!in_memory(wasi, buf, buf_len)) {
+    return WASI_EFAULT;
+  }
+  while (filled < buf_len) {
+    ssize_t n =
+        getrandom(wasi->memory->data + buf + filled, buf_len - filled, 0);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return errno_to_wasi(errno);
+    }
+    filled += (uint32_t)n;
+  }
+  return WASI_ESUCCESS;
+}
+
+uint32_t Z_wasi_extZ_fd_mapZ_iijii(wasi_t* wasi, uint32_t fd, uint64_t offset,
+                                   uint32_t size, uint32_t addr) {
+/* Without the signal handler, a write to the mapping would kill the host
+ * rather than trap. */
+#if WASM_RT_USE_MMAP && WASM_RT_MEMCHECK_SIGNAL_HANDLER
+  wasi_fd_t* entry = get_fd(wasi, fd);
+  struct stat host_stat;
+  uint32_t pages, old_pages, dest;
+  int flags;
+  if (!entry) {
+    return WASI_EBADF;
+  }
+  if (!in_memory(wasi, addr, 4)) {
+    return WASI_EFAULT;
+  }
+  /* Check everything mmap would refuse before growing memory, which cannot
+   * be undone: each failed call would leave the pages behind. */
+  if ((flags = fcntl(entry->host_fd, F_GETFL)) < 0 ||
+      fstat(entry->host_fd, &host_stat) != 0) {
+    return errno_to_wasi(errno);
+  }
+  if ((flags & O_ACCMODE) == O_WRONLY) {
+    return WASI_EACCES;
+  }
+  if (!S_ISREG(host_stat.st_mode) || size == 0 ||
+      offset % (uint64_t)sysconf(_SC_PAGESIZE) != 0 ||
+      offset + size > (uint64_t)host_stat.st_size) {
+    return WASI_EINVAL;
+  }
+  /* New pages at the end are not in use by the module's allocator, and are
+   * aligned to the wasm page size as mapping needs. */
+  pages = (uint32_t)(((uint64_t)size + 65535) / 65536);
+  old_pages = wasm_rt_grow_memory(wasi->memory, pages);
+  if (old_pages == (uint32_t)-1) {
+    return WASI_ENOMEM;
+  }
+  dest = old_pages * 65536;
+  if (wasm_rt_memory_map_file(wasi->memory, dest, entry->host_fd, offset,
+                              size) != 0) {
+    return errno_to_wasi(errno);
+  }
+  store_u32(wasi, addr, dest);
+  return WASI_ESUCCESS;
+#else
+  (void)wasi;
+  (void)fd;
+  (void)offset;
+  (void)size;
+  (void)addr;
+  return WASI_ENOTSUP;
+#endif
+}
+
+/* wasi_unstable differs from wasi_snapshot_preview1 only in fd_seek among
+ * these: it numbers `whence` CUR, END, SET. */
+uint32_t Z_wasi_unstableZ_fd_seekZ_iijii(wasi_t* wasi, uint32_t fd,
+                                         uint64_t offset, uint32_t whence,
+                                         uint32_t newoffset) {
+  switch (whence) {
+    case 0: return seek(wasi, fd, offset, SEEK_CUR, newoffset);
+    case 1: return seek(wasi, fd, offset, SEEK_END, newoffset);
+    case 2: return seek(wasi, fd, offset, SEEK_SET, newoffset);
+    default: return WASI_EINVAL;
+  }
+}
+
+#define WASI_UNSTABLE_ALIAS(result, name, params, args) \
+  result Z_wasi_unstableZ_##name params {               \
+    return Z_wasi_snapshot_preview1Z_##name args;       \
+  }
+
+WASI_UNSTABLE_ALIAS(uint32_t, args_getZ_iii,
+                    (wasi_t* w, uint32_t a, uint32_t b), (w, a, b))
+WASI_UNSTABLE_ALIAS(uint32_t, args_sizes_getZ_iii,
+                    (wasi_t* w, uint32_t a, uint32_t b), (w, a, b))
+WASI_UNSTABLE_ALIAS(uint32_t, environ_getZ_iii,
+                    (wasi_t* w, uint32_t a, uint32_t b), (w, a, b))
+WASI_UNSTABLE_ALIAS(uint32_t, environ_sizes_getZ_iii,
+                    (wasi_t* w, uint32_t a, uint32_t b), (w, a, b))
+WASI_UNSTABLE_ALIAS(uint32_t, clock_time_getZ_iiji,
+                    (wasi_t* w, uint32_t a, uint64_t b, uint32_t c),
+                    (w, a, b, c))
+WASI_UNSTABLE_ALIAS(uint32_t, fd_closeZ_ii, (wasi_t* w, uint32_t a), (w, a))
+WASI_UNSTABLE_ALIAS(uint32_t, fd_fdstat_getZ_iii,
+                    (wasi_t* w, uint32_t a, uint32_t b), (w, a, b))
+WASI_UNSTABLE_ALIAS(uint32_t, fd_prestat_getZ_iii,
+                    (wasi_t* w, uint32_t a, uint32_t b), (w, a, b))
+WASI_UNSTABLE_ALIAS(uint32_t, fd_prestat_dir_nameZ_iiii,
+                    (wasi_t* w, uint32_t a, uint32_t b, uint32_t c),
+                    (w, a, b, c))
+WASI_UNSTABLE_ALIAS(uint32_t, fd_readZ_iiiii,
+                    (wasi_t* w, uint32_t a, uint32_t b, uint32_t c,
+                     uint32_t d),
+                    (w, a, b, c, d))
+WASI_UNSTABLE_ALIAS(uint32_t, fd_writeZ_iiiii,
+                    (wasi_t* w, uint32_t a, uint32_t b, uint32_t c,
+                     uint32_t d),
+                    (w, a, b, c, d))
+WASI_UNSTABLE_ALIAS(uint32_t, path_openZ_iiiiiijjii,
+                    (wasi_t* w, uint32_t a, uint32_t b, uint32_t c,
+                     uint32_t d, uint32_t e, uint64_t f, uint64_t g,
+                     uint32_t h, uint32_t i),
+                    (w, a, b, c, d, e, f, g, h, i))
+WASI_UNSTABLE_ALIAS(uint32_t, random_getZ_iii,
+                    (wasi_t* w, uint32_t a, uint32_t b), (w, a, b))
+
+void Z_wasi_unstableZ_proc_exitZ_vi(wasi_t* wasi, uint32_t code) {
+  Z_wasi_snapshot_preview1Z_proc_exitZ_vi(wasi, code);
+}
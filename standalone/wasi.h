@@ -0,0 +1,202 @@
+/* WASI imports for wasm2c modules, for both wasi_snapshot_preview1 and the
+ * older wasi_unstable.
+ *
+ * Each import is defined under the name wasm2c gives it, and takes the
+ * `wasi_t` of the calling instance first, the way generated functions take
+ * their instance. Reads and writes go straight between the file and linear
+ * memory: the iovecs a module passes are translated into host iovecs that
+ * point into its memory, for a single readv or writev per call.
+ *
+ * Files are reached through preopened directories only, and paths that
+ * contain ".." or are absolute (other than under the preopen's own absolute
+ * name) are refused. Symlinks are only followed where they stay inside the
+ * preopen, or not at all on kernels without openat2, so a module cannot see
+ * outside of what it was given.
+ *
+ *   wasi_t wasi;
+ *   wasi_init(&wasi, Z_memory(&instance), argc, argv, environ);
+ *   wasi_preopen(&wasi, "/usr/src/app", "/usr/src/app");
+ *   wasi_buffer_output(&wasi, 64 * 1024, 60 * 1024);
+ *   wasm_rt_trap_t code = wasm_rt_impl_try();
+ *   if (code == WASM_RT_TRAP_EXIT)
+ *     return wasi.exit_code;
+ *   Z__startZ_vv(&instance);
+ *   wasi_flush(&wasi);
+ */
+#ifndef WASI_H_
+#define WASI_H_
+
+#include <stdint.h>
+
+#include "wasm-rt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A file descriptor of the module, and the host one it stands for. */
+typedef struct {
+  /** -1 if the descriptor is not open. */
+  int host_fd;
+  /** The path a preopened directory is known by to the module, or NULL. */
+  char* preopen_path;
+} wasi_fd_t;
+
+/** Output to the module's stdout or stderr, gathered in a ring so that many
+ * small writes, such as a log line per call, cost one writev. */
+typedef struct {
+  char* data;
+  uint32_t capacity;
+  /** The buffered bytes start at `data + start` and may wrap around. */
+  uint32_t start;
+  uint32_t length;
+  /** Flushed once this much is buffered. */
+  uint32_t flush_bytes;
+  /** Counters, from `wasi_buffer_output` on. */
+  uint64_t writes;
+  uint64_t flushes;
+  uint64_t flushed_bytes;
+  /** Total and longest time spent in the writev of a flush. */
+  uint64_t flush_ns;
+  uint64_t max_flush_ns;
+  /** Bytes lost because writing them to the host descriptor failed after
+   * they were buffered, and the module told they were written. */
+  uint64_t dropped_bytes;
+} wasi_output_t;
+
+/** The WASI state of one instance. */
+typedef struct {
+  wasm_rt_memory_t* memory;
+  /** Indexed by the module's descriptor number. */
+  wasi_fd_t* fds;
+  uint32_t fd_count;
+  uint32_t fd_capacity;
+  int argc;
+  char** argv;
+  char** envp;
+  /** The code passed to proc_exit, once it traps with `WASM_RT_TRAP_EXIT`. */
+  uint32_t exit_code;
+  /** If set, called when reading or writing a non-blocking descriptor would
+   * block, to wait until it is ready for `events` (EPOLLIN or EPOLLOUT);
+   * the call is then retried. With `fiber_loop_wait_fd` this suspends just
+   * the calling fiber. Returns -1 to give up with EAGAIN instead. */
+  int (*wait_fd)(void* wait_context, int fd, uint32_t events);
+  void* wait_context;
+  /** Buffers of descriptors 1 and 2, once `wasi_buffer_output` is called. */
+  wasi_output_t output[2];
+} wasi_t;
+
+/** Set up `wasi` for an instance using `memory`, with the host's stdin,
+ * stdout and stderr as descriptors 0 to 2. `argv` and the NULL-terminated
+ * `envp` are passed on to the module as they are, and must outlive `wasi`.
+ * Returns -1 if out of memory. */
+int wasi_init(wasi_t*, wasm_rt_memory_t* memory, int argc, char** argv,
+              char** envp);
+
+/** Let the module open files under the host directory `host_path`, which it
+ * knows as `guest_path`. Returns the descriptor the module sees it as, or -1
+ * with errno set if it cannot be opened. */
+int wasi_preopen(wasi_t*, const char* host_path, const char* guest_path);
+
+/** Buffer the module's writes to stdout and stderr in rings of `capacity`
+ * bytes each. A ring is flushed when it is `flush_bytes` full, when the
+ * descriptor is closed, and by `wasi_flush`, which the host must call when
+ * each call into the module returns: nothing else flushes a ring on a quiet
+ * module. A write too large for the ring goes out directly instead. If the
+ * host descriptor is non-blocking and does not take output as fast as the
+ * module writes it, a write that does not fit in what is left of the ring is
+ * cut short, or, with no room at all, waits through `wait_fd` or fails with
+ * EAGAIN. Returns -1 if out of memory. */
+int wasi_buffer_output(wasi_t*, uint32_t capacity, uint32_t flush_bytes);
+
+/** Write out whatever the module's stdout and stderr have buffered. */
+void wasi_flush(wasi_t*);
+
+/** Flush the module's output, close every descriptor the module opened or was
+ * given, other than 0 to 2, and release `wasi`. */
+void wasi_free(wasi_t*);
+
+uint32_t Z_wasi_snapshot_preview1Z_args_getZ_iii(wasi_t*, uint32_t argv,
+                                                 uint32_t argv_buf);
+uint32_t Z_wasi_snapshot_preview1Z_args_sizes_getZ_iii(wasi_t*,
+                                                       uint32_t argc,
+                                                       uint32_t argv_buf_size);
+uint32_t Z_wasi_snapshot_preview1Z_environ_getZ_iii(wasi_t*,
+                                                    uint32_t environ,
+                                                    uint32_t environ_buf);
+uint32_t Z_wasi_snapshot_preview1Z_environ_sizes_getZ_iii(
+    wasi_t*, uint32_t environ_count, uint32_t environ_buf_size);
+uint32_t Z_wasi_snapshot_preview1Z_clock_time_getZ_iiji(wasi_t*,
+                                                        uint32_t clock_id,
+                                                        uint64_t precision,
+                                                        uint32_t time);
+uint32_t Z_wasi_snapshot_preview1Z_fd_closeZ_ii(wasi_t*, uint32_t fd);
+uint32_t Z_wasi_snapshot_preview1Z_fd_fdstat_getZ_iii(wasi_t*, uint32_t fd,
+                                                      uint32_t stat);
+uint32_t Z_wasi_snapshot_preview1Z_fd_prestat_getZ_iii(wasi_t*, uint32_t fd,
+                                                       uint32_t prestat);
+uint32_t Z_wasi_snapshot_preview1Z_fd_prestat_dir_nameZ_iiii(
+    wasi_t*, uint32_t fd, uint32_t path, uint32_t path_len);
+uint32_t Z_wasi_snapshot_preview1Z_fd_readZ_iiiii(wasi_t*, uint32_t fd,
+                                                  uint32_t iovs,
+                                                  uint32_t iovs_len,
+                                                  uint32_t nread);
+uint32_t Z_wasi_snapshot_preview1Z_fd_seekZ_iijii(wasi_t*, uint32_t fd,
+                                                  uint64_t offset,
+                                                  uint32_t whence,
+                                                  uint32_t newoffset);
+uint32_t Z_wasi_snapshot_preview1Z_fd_writeZ_iiiii(wasi_t*, uint32_t fd,
+                                                   uint32_t iovs,
+                                                   uint32_t iovs_len,
+                                                   uint32_t nwritten);
+uint32_t Z_wasi_snapshot_preview1Z_path_openZ_iiiiiijjii(
+    wasi_t*, uint32_t dirfd, uint32_t dirflags, uint32_t path,
+    uint32_t path_len, uint32_t oflags, uint64_t fs_rights_base,
+    uint64_t fs_rights_inheriting, uint32_t fdflags, uint32_t fd);
+void Z_wasi_snapshot_preview1Z_proc_exitZ_vi(wasi_t*, uint32_t code);
+uint32_t Z_wasi_snapshot_preview1Z_random_getZ_iii(wasi_t*, uint32_t buf,
+                                                   uint32_t buf_len);
+
+/** A host extension rather than part of WASI, imported from "wasi_ext":
+ * `fd_map(fd: i32, offset: i64, size: i32, addr: i32) -> errno`. Grows the
+ * module's memory by enough pages for `size` bytes of the file `fd` from
+ * `offset`, maps them there read-only with `wasm_rt_memory_map_file`, and
+ * stores where at `addr`. The module reads the file in place, with no copy;
+ * writing to it traps. `fd` must be a regular file open for reading, and
+ * `offset` a multiple of the host page size. The mapping lasts until the
+ * memory is reset or freed. Only available with
+ * `WASM_RT_MEMCHECK_SIGNAL_HANDLER`, which turns those writes into traps;
+ * otherwise returns ENOTSUP. */
+uint32_t Z_wasi_extZ_fd_mapZ_iijii(wasi_t*, uint32_t fd, uint64_t offset,
+                                   uint32_t size, uint32_t addr);
+
+/* The same for wasi_unstable, whose fd_seek numbers `whence` differently. */
+uint32_t Z_wasi_unstableZ_args_getZ_iii(wasi_t*, uint32_t, uint32_t);
+uint32_t Z_wasi_unstableZ_args_sizes_getZ_iii(wasi_t*, uint32_t, uint32_t);
+uint32_t Z_wasi_unstableZ_environ_getZ_iii(wasi_t*, uint32_t, uint32_t);
+uint32_t Z_wasi_unstableZ_environ_sizes_getZ_iii(wasi_t*, uint32_t, uint32_t);
+uint32_t Z_wasi_unstableZ_clock_time_getZ_iiji(wasi_t*, uint32_t, uint64_t,
+                                               uint32_t);
+uint32_t Z_wasi_unstableZ_fd_closeZ_ii(wasi_t*, uint32_t);
+uint32_t Z_wasi_unstableZ_fd_fdstat_getZ_iii(wasi_t*, uint32_t, uint32_t);
+uint32_t Z_wasi_unstableZ_fd_prestat_getZ_iii(wasi_t*, uint32_t, uint32_t);
+uint32_t Z_wasi_unstableZ_fd_prestat_dir_nameZ_iiii(wasi_t*, uint32_t,
+                                                    uint32_t, uint32_t);
+uint32_t Z_wasi_unstableZ_fd_readZ_iiiii(wasi_t*, uint32_t, uint32_t,
+                                         uint32_t, uint32_t);
+uint32_t Z_wasi_unstableZ_fd_seekZ_iijii(wasi_t*, uint32_t, uint64_t,
+                                         uint32_t, uint32_t);
+uint32_t Z_wasi_unstableZ_fd_writeZ_iiiii(wasi_t*, uint32_t, uint32_t,
+                                          uint32_t, uint32_t);
+uint32_t Z_wasi_unstableZ_path_openZ_iiiiiijjii(wasi_t*, uint32_t, uint32_t,
+                                                uint32_t, uint32_t, uint32_t,
+                                                uint64_t, uint64_t, uint32_t,
+                                                uint32_t);
+void Z_wasi_unstableZ_proc_exitZ_vi(wasi_t*, uint32_t);
+uint32_t Z_wasi_unstableZ_random_getZ_iii(wasi_t*, uint32_t, uint32_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WASI_H_ */
@@ -14,93 +14,856 @@
  * limitations under the License.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+/* For mremap. */
+#define _GNU_SOURCE
+#endif
+
 #include "wasm-rt-impl.h"
 
 #include <assert.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if WASM_RT_USE_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <pthread.h>
+#include <time.h>
+
+#if WASM_RT_PROFILE
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+#if WASM_RT_MEMCHECK_SIGNAL_HANDLER || WASM_RT_STACK_GUARD_PAGE
+#define USE_SIGNAL_HANDLER 1
+#include <signal.h>
+#else
+#define USE_SIGNAL_HANDLER 0
+#endif
+
+#if WASM_RT_STACK_GUARD_PAGE || WASM_RT_FIBERS
+#include <ucontext.h>
+#endif
+
+#if WASM_RT_FIBERS && !WASM_RT_USE_MMAP
+#include <sys/mman.h>
+#endif
+
 #define PAGE_SIZE 65536
 
+#if WASM_RT_STACK_GUARD_PAGE
+/* Inaccessible bytes below each wasm stack. Generated functions have small
+ * frames, so any overflow touches this before going past it. */
+#define STACK_GUARD_SIZE 65536
+/* The stack the signal handler runs on, since the faulting one is full. */
+#define SIGNAL_STACK_SIZE 65536
+#endif
+
+#if WASM_RT_MEMCHECK_SIGNAL_HANDLER
+/* Generated code addresses memory with a u32 index plus a u32 offset, so 8GiB
+ * covers every access it can make, however far out of bounds. */
+#define MEMORY_RESERVATION_SIZE 0x200000000ull
+#endif
+
+#if WASM_RT_FIBERS
+/* Inaccessible bytes below each fiber stack. With WASM_RT_STACK_GUARD_PAGE a
+ * fiber stack stands in for the wasm stack, so its guard is as large. */
+#if WASM_RT_STACK_GUARD_PAGE
+#define FIBER_GUARD_SIZE STACK_GUARD_SIZE
+#else
+#define FIBER_GUARD_SIZE 65536
+#endif
+#endif
+
+/* Signatures are stored in chunks of this many bytes, one byte per type. */
+#define FUNC_TYPE_ARENA_CHUNK_SIZE 16384
+
 typedef struct FuncType {
-  wasm_rt_type_t* params;
-  wasm_rt_type_t* results;
+  /* The params followed by the results, in the func type arena. */
+  const uint8_t* types;
   uint32_t param_count;
   uint32_t result_count;
+  uint32_t hash;
 } FuncType;
 
-uint32_t wasm_rt_call_stack_depth;
-uint32_t g_saved_call_stack_depth;
+typedef struct FuncTypeArenaChunk {
+  struct FuncTypeArenaChunk* prev;
+  uint32_t size;
+  uint32_t used;
+  uint8_t data[];
+} FuncTypeArenaChunk;
+
+WASM_RT_THREAD_LOCAL uint32_t wasm_rt_call_stack_depth;
+WASM_RT_THREAD_LOCAL uint32_t g_saved_call_stack_depth;
+
+WASM_RT_THREAD_LOCAL void* g_saved_profile_context;
 
-jmp_buf g_jmp_buf;
+WASM_RT_THREAD_LOCAL jmp_buf g_jmp_buf;
+WASM_RT_THREAD_LOCAL wasm_rt_try_scope_t* g_try_scope;
 FuncType* g_func_types;
 uint32_t g_func_type_count;
+static uint32_t g_func_type_capacity;
+/* Open-addressed hash set of func types, holding `index + 1` into
+ * g_func_types, or 0 for an empty slot. Its capacity is a power of two. */
+static uint32_t* g_func_type_set;
+static uint32_t g_func_type_set_capacity;
+static FuncTypeArenaChunk* g_func_type_arena;
+static pthread_mutex_t g_func_types_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#if WASM_RT_MEMCHECK_SIGNAL_HANDLER
+typedef struct MemoryReservation {
+  uint8_t* base;
+  struct MemoryReservation* next;
+} MemoryReservation;
+
+static MemoryReservation* g_memory_reservations;
+/* Guards changes to g_memory_reservations. The signal handler only reads it,
+ * and entries are fully set up before they are linked in. */
+static pthread_mutex_t g_memory_reservations_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+#if WASM_RT_STACK_GUARD_PAGE
+/* The calling thread's wasm stack; see `wasm_rt_call_with_stack`. */
+typedef struct WasmStack {
+  /* The lowest address of the stack, where its guard region starts. */
+  uint8_t* base;
+  ucontext_t caller;
+  ucontext_t callee;
+  void (*func)(void*);
+  void* arg;
+  wasm_rt_trap_t trap;
+  bool active;
+} WasmStack;
+
+static WASM_RT_THREAD_LOCAL WasmStack g_wasm_stack;
+static WASM_RT_THREAD_LOCAL bool g_has_signal_stack;
+#endif
+
+#if WASM_RT_FIBERS
+/* The per thread state that belongs to whichever call is running, and so is
+ * switched along with the stack when fibers are. */
+typedef struct TrapContext {
+  jmp_buf jmp_buf;
+  uint32_t call_stack_depth;
+  uint32_t saved_call_stack_depth;
+  wasm_rt_try_scope_t* try_scope;
+  void* saved_profile_context;
+#if WASM_RT_PROFILE
+  void* profile_context;
+#endif
+#if WASM_RT_STACK_GUARD_PAGE
+  uint8_t* stack_base;
+  bool stack_active;
+#endif
+} TrapContext;
+
+struct wasm_rt_fiber_t {
+  /* The lowest address of the stack, where its guard region starts. */
+  uint8_t* base;
+  ucontext_t context;
+  /* Where `wasm_rt_fiber_resume` was called, to return to on suspend. */
+  ucontext_t caller;
+  TrapContext trap_context;
+  TrapContext caller_trap_context;
+  /* The fiber that resumed this one, or NULL. */
+  wasm_rt_fiber_t* resumer;
+  void (*func)(void*);
+  void* arg;
+  wasm_rt_fiber_state_t state;
+  wasm_rt_trap_t trap;
+};
+
+static WASM_RT_THREAD_LOCAL wasm_rt_fiber_t* g_current_fiber;
+#endif
+
+static uint64_t monotonic_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
 
 void wasm_rt_trap(wasm_rt_trap_t code) {
   assert(code != WASM_RT_TRAP_NONE);
+  wasm_rt_try_scope_t* scope = g_try_scope;
+  if (scope) {
+    g_try_scope = scope->prev;
+    wasm_rt_call_stack_depth = scope->saved_call_stack_depth;
+#if WASM_RT_PROFILE
+    wasm_rt_profile_context = scope->saved_profile_context;
+#endif
+    longjmp(scope->buf, code);
+  }
   wasm_rt_call_stack_depth = g_saved_call_stack_depth;
+#if WASM_RT_PROFILE
+  wasm_rt_profile_context = g_saved_profile_context;
+#endif
   longjmp(g_jmp_buf, code);
 }
 
-static bool func_types_are_equal(FuncType* a, FuncType* b) {
-  if (a->param_count != b->param_count || a->result_count != b->result_count)
-    return 0;
-  int i;
-  for (i = 0; i < a->param_count; ++i)
-    if (a->params[i] != b->params[i])
-      return 0;
-  for (i = 0; i < a->result_count; ++i)
-    if (a->results[i] != b->results[i])
-      return 0;
-  return 1;
+#if WASM_RT_FUEL
+WASM_RT_THREAD_LOCAL int64_t wasm_rt_fuel = INT64_MAX;
+static WASM_RT_THREAD_LOCAL wasm_rt_fuel_handler_t g_fuel_handler;
+static WASM_RT_THREAD_LOCAL void* g_fuel_handler_data;
+
+void wasm_rt_set_fuel_handler(wasm_rt_fuel_handler_t handler,
+                              void* user_data) {
+  g_fuel_handler = handler;
+  g_fuel_handler_data = user_data;
+}
+
+void wasm_rt_fuel_exhausted(void) {
+  if (g_fuel_handler)
+    g_fuel_handler(g_fuel_handler_data);
+  if (wasm_rt_fuel < 0)
+    wasm_rt_trap(WASM_RT_TRAP_FUEL);
+}
+#endif
+
+static bool func_types_are_equal(const FuncType* a, const FuncType* b) {
+  return a->hash == b->hash && a->param_count == b->param_count &&
+         a->result_count == b->result_count &&
+         memcmp(a->types, b->types, a->param_count + a->result_count) == 0;
+}
+
+/* FNV-1a over the counts and the types. With the lowest bit set this is the
+ * canonical ID described for WASM_RT_STATIC_FUNC_TYPES in wasm-rt.h. */
+static uint32_t hash_func_type(const FuncType* func_type) {
+  uint32_t hash = 2166136261u;
+  uint32_t count = func_type->param_count + func_type->result_count;
+  uint32_t i;
+  hash = (hash ^ func_type->param_count) * 16777619u;
+  hash = (hash ^ func_type->result_count) * 16777619u;
+  for (i = 0; i < count; ++i)
+    hash = (hash ^ func_type->types[i]) * 16777619u;
+  return hash | 1;
+}
+
+static uint8_t* arena_alloc(uint32_t size) {
+  FuncTypeArenaChunk* chunk = g_func_type_arena;
+  if (!chunk || chunk->size - chunk->used < size) {
+    uint32_t chunk_size = size > FUNC_TYPE_ARENA_CHUNK_SIZE
+                              ? size
+                              : FUNC_TYPE_ARENA_CHUNK_SIZE;
+    chunk = malloc(sizeof(FuncTypeArenaChunk) + chunk_size);
+    if (!chunk) {
+      perror("malloc failed");
+      abort();
+    }
+    chunk->prev = g_func_type_arena;
+    chunk->size = chunk_size;
+    chunk->used = 0;
+    g_func_type_arena = chunk;
+  }
+  uint8_t* result = chunk->data + chunk->used;
+  chunk->used += size;
+  return result;
+}
+
+/* Give back the most recent `arena_alloc`. */
+static void arena_free_last(uint32_t size) {
+  g_func_type_arena->used -= size;
+}
+
+/* Return the slot holding `func_type`, or the empty slot where it belongs. */
+static uint32_t* find_func_type_slot(const FuncType* func_type) {
+  uint32_t mask = g_func_type_set_capacity - 1;
+  uint32_t i = func_type->hash & mask;
+  for (;; i = (i + 1) & mask) {
+    uint32_t* slot = &g_func_type_set[i];
+    if (*slot == 0 ||
+        func_types_are_equal(&g_func_types[*slot - 1], func_type))
+      return slot;
+  }
+}
+
+#if WASM_RT_STATIC_FUNC_TYPES
+/* Whether a type other than `func_type` already has its hash. Such types are
+ * all on the probe sequence before the empty slot `func_type` would take. */
+static bool func_type_id_is_taken(const FuncType* func_type) {
+  uint32_t mask = g_func_type_set_capacity - 1;
+  uint32_t i = func_type->hash & mask;
+  for (; g_func_type_set[i]; i = (i + 1) & mask) {
+    if (g_func_types[g_func_type_set[i] - 1].hash == func_type->hash)
+      return true;
+  }
+  return false;
+}
+#endif
+
+static void grow_func_type_set(void) {
+  uint32_t* old_set = g_func_type_set;
+  uint32_t old_capacity = g_func_type_set_capacity;
+  g_func_type_set_capacity = old_capacity ? old_capacity * 2 : 64;
+  g_func_type_set = calloc(g_func_type_set_capacity, sizeof(uint32_t));
+  if (!g_func_type_set) {
+    perror("calloc failed");
+    abort();
+  }
+  uint32_t i;
+  for (i = 0; i < old_capacity; ++i) {
+    if (old_set[i])
+      *find_func_type_slot(&g_func_types[old_set[i] - 1]) = old_set[i];
+  }
+  free(old_set);
 }
 
 uint32_t wasm_rt_register_func_type(uint32_t param_count,
                                     uint32_t result_count,
                                     ...) {
+  uint32_t count = param_count + result_count;
+
+  pthread_mutex_lock(&g_func_types_mutex);
+  /* Keep the set at most half full, so probe sequences stay short. */
+  if ((g_func_type_count + 1) * 2 > g_func_type_set_capacity)
+    grow_func_type_set();
+
+  /* Build the signature in place at the end of the arena; it is given back
+   * if the same signature was registered before. */
   FuncType func_type;
+  uint8_t* types = arena_alloc(count);
+  func_type.types = types;
   func_type.param_count = param_count;
-  func_type.params = malloc(param_count * sizeof(wasm_rt_type_t));
   func_type.result_count = result_count;
-  func_type.results = malloc(result_count * sizeof(wasm_rt_type_t));
 
   va_list args;
   va_start(args, result_count);
-
   uint32_t i;
-  for (i = 0; i < param_count; ++i)
-    func_type.params[i] = va_arg(args, wasm_rt_type_t);
-  for (i = 0; i < result_count; ++i)
-    func_type.results[i] = va_arg(args, wasm_rt_type_t);
+  for (i = 0; i < count; ++i)
+    types[i] = (uint8_t)va_arg(args, wasm_rt_type_t);
   va_end(args);
+  func_type.hash = hash_func_type(&func_type);
 
-  for (i = 0; i < g_func_type_count; ++i) {
-    if (func_types_are_equal(&g_func_types[i], &func_type)) {
-      free(func_type.params);
-      free(func_type.results);
-      return i + 1;
+  uint32_t* slot = find_func_type_slot(&func_type);
+  if (*slot) {
+    arena_free_last(count);
+  } else {
+#if WASM_RT_STATIC_FUNC_TYPES
+    if (func_type_id_is_taken(&func_type)) {
+      fprintf(stderr,
+              "func type ID collision (0x%08x); rebuild without "
+              "WASM_RT_STATIC_FUNC_TYPES\n",
+              func_type.hash);
+      abort();
+    }
+#endif
+    if (g_func_type_count == g_func_type_capacity) {
+      g_func_type_capacity = g_func_type_capacity ? g_func_type_capacity * 2
+                                                  : 64;
+      g_func_types =
+          realloc(g_func_types, g_func_type_capacity * sizeof(FuncType));
+      if (!g_func_types) {
+        perror("realloc failed");
+        abort();
+      }
     }
+    g_func_types[g_func_type_count++] = func_type;
+    *slot = g_func_type_count;
+  }
+#if WASM_RT_STATIC_FUNC_TYPES
+  uint32_t result = g_func_types[*slot - 1].hash;
+#else
+  uint32_t result = *slot;
+#endif
+  pthread_mutex_unlock(&g_func_types_mutex);
+  return result;
+}
+
+#if USE_SIGNAL_HANDLER
+#if WASM_RT_MEMCHECK_SIGNAL_HANDLER
+static bool is_reserved_address(const uint8_t* addr) {
+  MemoryReservation* reservation;
+  for (reservation = g_memory_reservations; reservation;
+       reservation = reservation->next) {
+    if (addr >= reservation->base &&
+        addr < reservation->base + MEMORY_RESERVATION_SIZE)
+      return true;
+  }
+  return false;
+}
+
+#endif
+
+#if WASM_RT_STACK_GUARD_PAGE
+static bool is_stack_guard_address(const uint8_t* addr) {
+  const uint8_t* base = g_wasm_stack.base;
+  return base && addr >= base && addr < base + STACK_GUARD_SIZE;
+}
+#endif
+
+static void signal_handler(int sig, siginfo_t* si, void* context) {
+  (void)context;
+#if WASM_RT_STACK_GUARD_PAGE
+  if (is_stack_guard_address(si->si_addr))
+    wasm_rt_trap(WASM_RT_TRAP_EXHAUSTION);
+#endif
+#if WASM_RT_MEMCHECK_SIGNAL_HANDLER
+  if (is_reserved_address(si->si_addr))
+    wasm_rt_trap(WASM_RT_TRAP_OOB);
+#endif
+
+  /* Not caused by wasm code; let the fault happen again with the default
+   * action so it still crashes the process. */
+  signal(sig, SIG_DFL);
+}
+
+static void do_install_signal_handler(void) {
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sigemptyset(&sa.sa_mask);
+  /* SA_NODEFER keeps the signal unblocked after wasm_rt_trap longjmps out of
+   * the handler, so the next out-of-bounds access traps as well. */
+  sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+#if WASM_RT_STACK_GUARD_PAGE
+  sa.sa_flags |= SA_ONSTACK;
+#endif
+  sa.sa_sigaction = signal_handler;
+  /* macOS reports accesses to PROT_NONE pages as SIGBUS. */
+  if (sigaction(SIGSEGV, &sa, NULL) != 0 ||
+      sigaction(SIGBUS, &sa, NULL) != 0) {
+    perror("sigaction failed");
+    abort();
   }
+}
 
-  uint32_t idx = g_func_type_count++;
-  g_func_types = realloc(g_func_types, g_func_type_count * sizeof(FuncType));
-  g_func_types[idx] = func_type;
-  return idx + 1;
+static void install_signal_handler(void) {
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, do_install_signal_handler);
 }
+#endif
+
+#if WASM_RT_STACK_GUARD_PAGE
+/* The signal handler runs on a stack of its own, since the faulting one is
+ * full. Signal stacks are per thread. */
+static void install_signal_stack(void) {
+  if (g_has_signal_stack)
+    return;
+  install_signal_handler();
+  stack_t signal_stack;
+  signal_stack.ss_sp = malloc(SIGNAL_STACK_SIZE);
+  signal_stack.ss_size = SIGNAL_STACK_SIZE;
+  signal_stack.ss_flags = 0;
+  if (sigaltstack(&signal_stack, NULL) != 0) {
+    perror("sigaltstack failed");
+    abort();
+  }
+  g_has_signal_stack = true;
+}
+
+static void allocate_wasm_stack(WasmStack* stack) {
+  install_signal_stack();
+
+  uint8_t* base = mmap(NULL, STACK_GUARD_SIZE + WASM_RT_STACK_SIZE,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED || mprotect(base, STACK_GUARD_SIZE, PROT_NONE) != 0) {
+    perror("failed to allocate wasm stack");
+    abort();
+  }
+  stack->base = base;
+}
+
+/* Entry point of the wasm stack. Traps are caught here, on the same stack they
+ * happen on, and rethrown by `wasm_rt_call_with_stack` on the caller's. */
+static void run_on_wasm_stack(void) {
+  WasmStack* stack = &g_wasm_stack;
+  wasm_rt_try_scope_t scope;
+  wasm_rt_trap_t code = wasm_rt_impl_try_scope(&scope);
+  if (code == WASM_RT_TRAP_NONE)
+    stack->func(stack->arg);
+  wasm_rt_impl_end_try_scope(&scope);
+  stack->trap = code;
+}
+#endif
+
+void wasm_rt_call_with_stack(void (*func)(void*), void* arg) {
+#if WASM_RT_STACK_GUARD_PAGE
+  WasmStack* stack = &g_wasm_stack;
+  if (stack->active) {
+    /* Called back from a host function; already on the wasm stack. */
+    func(arg);
+    return;
+  }
+  if (!stack->base)
+    allocate_wasm_stack(stack);
+
+  getcontext(&stack->callee);
+  stack->callee.uc_stack.ss_sp = stack->base + STACK_GUARD_SIZE;
+  stack->callee.uc_stack.ss_size = WASM_RT_STACK_SIZE;
+  stack->callee.uc_link = &stack->caller;
+  makecontext(&stack->callee, run_on_wasm_stack, 0);
+  stack->func = func;
+  stack->arg = arg;
+  stack->active = true;
+  swapcontext(&stack->caller, &stack->callee);
+  stack->active = false;
+  if (stack->trap != WASM_RT_TRAP_NONE)
+    wasm_rt_trap(stack->trap);
+#else
+  func(arg);
+#endif
+}
+
+#if WASM_RT_FIBERS
+/* Move the calling thread's trap state into `save`, and replace it with
+ * `load`. */
+static void switch_trap_context(TrapContext* save, const TrapContext* load) {
+  memcpy(save->jmp_buf, g_jmp_buf, sizeof(jmp_buf));
+  save->call_stack_depth = wasm_rt_call_stack_depth;
+  save->saved_call_stack_depth = g_saved_call_stack_depth;
+  save->try_scope = g_try_scope;
+  save->saved_profile_context = g_saved_profile_context;
+#if WASM_RT_PROFILE
+  save->profile_context = wasm_rt_profile_context;
+#endif
+#if WASM_RT_STACK_GUARD_PAGE
+  save->stack_base = g_wasm_stack.base;
+  save->stack_active = g_wasm_stack.active;
+#endif
+
+  memcpy(g_jmp_buf, load->jmp_buf, sizeof(jmp_buf));
+  wasm_rt_call_stack_depth = load->call_stack_depth;
+  g_saved_call_stack_depth = load->saved_call_stack_depth;
+  g_try_scope = load->try_scope;
+  g_saved_profile_context = load->saved_profile_context;
+#if WASM_RT_PROFILE
+  wasm_rt_profile_context = load->profile_context;
+#endif
+#if WASM_RT_STACK_GUARD_PAGE
+  g_wasm_stack.base = load->stack_base;
+  g_wasm_stack.active = load->stack_active;
+#endif
+}
+
+/* Entry point of every fiber. Traps the fiber does not catch itself end up
+ * here, on its own stack. */
+static void run_fiber(void) {
+  wasm_rt_fiber_t* fiber = g_current_fiber;
+  wasm_rt_try_scope_t scope;
+  wasm_rt_trap_t code = wasm_rt_impl_try_scope(&scope);
+  if (code == WASM_RT_TRAP_NONE)
+    fiber->func(fiber->arg);
+  wasm_rt_impl_end_try_scope(&scope);
+  fiber->trap = code;
+  fiber->state = WASM_RT_FIBER_DONE;
+  switch_trap_context(&fiber->trap_context, &fiber->caller_trap_context);
+  g_current_fiber = fiber->resumer;
+  /* Returning continues at `caller` through uc_link. */
+}
+
+/* Make `fiber` start in run_fiber on its own stack. getcontext is kept out
+ * of wasm_rt_fiber_new, whose locals the compiler would otherwise have to
+ * treat as clobbered by a second return. */
+static bool init_fiber_context(wasm_rt_fiber_t* fiber) {
+  if (getcontext(&fiber->context) != 0)
+    return false;
+  fiber->context.uc_stack.ss_sp = fiber->base + FIBER_GUARD_SIZE;
+  fiber->context.uc_stack.ss_size = WASM_RT_FIBER_STACK_SIZE;
+  fiber->context.uc_link = &fiber->caller;
+  makecontext(&fiber->context, run_fiber, 0);
+  return true;
+}
+
+wasm_rt_fiber_t* wasm_rt_fiber_new(void (*func)(void*), void* arg) {
+  wasm_rt_fiber_t* fiber = calloc(1, sizeof(wasm_rt_fiber_t));
+  if (!fiber)
+    return NULL;
+  fiber->base = mmap(NULL, FIBER_GUARD_SIZE + WASM_RT_FIBER_STACK_SIZE,
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (fiber->base == MAP_FAILED) {
+    free(fiber);
+    return NULL;
+  }
+  if (mprotect(fiber->base, FIBER_GUARD_SIZE, PROT_NONE) != 0 ||
+      !init_fiber_context(fiber)) {
+    munmap(fiber->base, FIBER_GUARD_SIZE + WASM_RT_FIBER_STACK_SIZE);
+    free(fiber);
+    return NULL;
+  }
+#if WASM_RT_STACK_GUARD_PAGE
+  fiber->trap_context.stack_base = fiber->base;
+  fiber->trap_context.stack_active = true;
+#endif
+  fiber->func = func;
+  fiber->arg = arg;
+  fiber->state = WASM_RT_FIBER_READY;
+  return fiber;
+}
+
+wasm_rt_fiber_state_t wasm_rt_fiber_resume(wasm_rt_fiber_t* fiber) {
+  assert(fiber->state == WASM_RT_FIBER_READY ||
+         fiber->state == WASM_RT_FIBER_SUSPENDED);
+#if WASM_RT_STACK_GUARD_PAGE
+  install_signal_stack();
+#endif
+  fiber->resumer = g_current_fiber;
+  fiber->state = WASM_RT_FIBER_RUNNING;
+  g_current_fiber = fiber;
+  switch_trap_context(&fiber->caller_trap_context, &fiber->trap_context);
+  swapcontext(&fiber->caller, &fiber->context);
+  return fiber->state;
+}
+
+void wasm_rt_fiber_suspend(void) {
+  wasm_rt_fiber_t* fiber = g_current_fiber;
+  assert(fiber != NULL);
+  fiber->state = WASM_RT_FIBER_SUSPENDED;
+  switch_trap_context(&fiber->trap_context, &fiber->caller_trap_context);
+  g_current_fiber = fiber->resumer;
+  swapcontext(&fiber->context, &fiber->caller);
+}
+
+wasm_rt_fiber_t* wasm_rt_fiber_current(void) {
+  return g_current_fiber;
+}
+
+wasm_rt_trap_t wasm_rt_fiber_trap(const wasm_rt_fiber_t* fiber) {
+  return fiber->trap;
+}
+
+void wasm_rt_fiber_free(wasm_rt_fiber_t* fiber) {
+  if (!fiber)
+    return;
+  assert(fiber->state != WASM_RT_FIBER_RUNNING);
+  munmap(fiber->base, FIBER_GUARD_SIZE + WASM_RT_FIBER_STACK_SIZE);
+  free(fiber);
+}
+#endif
+
+#if WASM_RT_USE_MMAP
+static uint64_t reservation_size(uint32_t initial_pages, uint32_t max_pages) {
+#if WASM_RT_MEMCHECK_SIGNAL_HANDLER
+  (void)initial_pages;
+  (void)max_pages;
+  return MEMORY_RESERVATION_SIZE;
+#else
+  uint32_t pages = max_pages < WASM_RT_MAX_RESERVED_PAGES
+                       ? max_pages
+                       : WASM_RT_MAX_RESERVED_PAGES;
+  if (pages < initial_pages)
+    pages = initial_pages;
+  /* mmap refuses empty mappings. */
+  if (pages == 0)
+    pages = 1;
+  return (uint64_t)pages * PAGE_SIZE;
+#endif
+}
+
+/* Reserve `size` bytes of inaccessible address space. Pages are committed by
+ * making them readable and writable; until then they cost no memory. */
+static uint8_t* reserve_memory(uint64_t size) {
+  void* addr = mmap(NULL, size, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return addr == MAP_FAILED ? NULL : addr;
+}
+
+static bool commit_pages(uint8_t* data, uint32_t first_page, uint32_t pages) {
+  return mprotect(data + (uint64_t)first_page * PAGE_SIZE,
+                  (uint64_t)pages * PAGE_SIZE, PROT_READ | PROT_WRITE) == 0;
+}
+
+/* Put zeroed, writable anonymous pages at `data`, in place of whatever is
+ * mapped there. */
+static bool map_zero_pages(uint8_t* data, uint64_t length) {
+  return mmap(data, length, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1,
+              0) != MAP_FAILED;
+}
+
+/* Replace every file mapped over `memory` with zeroed pages. */
+static void unmap_files(wasm_rt_memory_t* memory) {
+  uint32_t i;
+  for (i = 0; i < memory->file_map_count; ++i) {
+    const wasm_rt_file_map_t* map = &memory->file_maps[i];
+    if (!map_zero_pages(memory->data + map->dest, map->length)) {
+      perror("mmap failed");
+      abort();
+    }
+  }
+  free(memory->file_maps);
+  memory->file_maps = NULL;
+  memory->file_map_count = 0;
+}
+
+/* Move the committed pages of `memory` into a larger reservation. This only
+ * happens when the maximum size could not be reserved up front. On Linux the
+ * pages are remapped rather than copied. */
+static bool grow_reservation(wasm_rt_memory_t* memory, uint64_t min_size) {
+  uint64_t max_size = (uint64_t)memory->max_pages * PAGE_SIZE;
+  uint64_t new_reserved_size = memory->reserved_size * 2;
+  if (new_reserved_size < min_size)
+    new_reserved_size = min_size;
+  if (new_reserved_size > max_size)
+    new_reserved_size = max_size;
+
+  uint8_t* new_data = reserve_memory(new_reserved_size);
+  if (new_data == NULL)
+    return false;
+  if (memory->size != 0) {
+#ifdef __linux__
+    /* A memory instantiated from a snapshot is made of more than one
+     * mapping, which mremap can't move in one go; copy it instead. */
+    if (mremap(memory->data, memory->size, memory->size,
+               MREMAP_MAYMOVE | MREMAP_FIXED, new_data) == MAP_FAILED)
+#endif
+    {
+      if (!commit_pages(new_data, 0, memory->pages)) {
+        munmap(new_data, new_reserved_size);
+        return false;
+      }
+      memcpy(new_data, memory->data, memory->size);
+    }
+  }
+  munmap(memory->data, memory->reserved_size);
+  memory->data = new_data;
+  memory->reserved_size = new_reserved_size;
+  /* Any files mapped in were copied like the rest, and are gone. */
+  free(memory->file_maps);
+  memory->file_maps = NULL;
+  memory->file_map_count = 0;
+  return true;
+}
+
+static void allocate_reservation(wasm_rt_memory_t* memory,
+                                 uint32_t initial_pages,
+                                 uint32_t max_pages) {
+#if WASM_RT_MEMCHECK_SIGNAL_HANDLER
+  install_signal_handler();
+#endif
+  memory->pages = initial_pages;
+  memory->max_pages = max_pages;
+  memory->size = initial_pages * PAGE_SIZE;
+  memory->reserved_size = reservation_size(initial_pages, max_pages);
+  memory->peak_pages = initial_pages;
+  memory->grow_count = 0;
+  memory->failed_grow_count = 0;
+  memory->grow_ns = 0;
+  memory->file_maps = NULL;
+  memory->file_map_count = 0;
+  memory->data = reserve_memory(memory->reserved_size);
+  if (memory->data == NULL) {
+    perror("mmap failed");
+    abort();
+  }
+#if WASM_RT_MEMCHECK_SIGNAL_HANDLER
+  /* Entries are reused rather than freed, so the signal handler never walks
+   * into freed memory. */
+  pthread_mutex_lock(&g_memory_reservations_mutex);
+  MemoryReservation* reservation;
+  for (reservation = g_memory_reservations; reservation;
+       reservation = reservation->next) {
+    if (reservation->base == NULL)
+      break;
+  }
+  if (reservation) {
+    reservation->base = memory->data;
+  } else {
+    reservation = malloc(sizeof(MemoryReservation));
+    reservation->base = memory->data;
+    reservation->next = g_memory_reservations;
+    g_memory_reservations = reservation;
+  }
+  pthread_mutex_unlock(&g_memory_reservations_mutex);
+#endif
+}
+
+static int create_snapshot_file(void) {
+#ifdef __linux__
+  return memfd_create("wasm-rt-snapshot", MFD_CLOEXEC);
+#else
+  char path[] = "/tmp/wasm-rt-snapshot-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd >= 0)
+    unlink(path);
+  return fd;
+#endif
+}
+
+static bool is_zero_page(const uint8_t* page) {
+  static const uint8_t zeroes[PAGE_SIZE];
+  return memcmp(page, zeroes, PAGE_SIZE) == 0;
+}
+
+void wasm_rt_snapshot_memory(wasm_rt_memory_snapshot_t* snapshot,
+                             const wasm_rt_memory_t* memory) {
+  snapshot->pages = memory->pages;
+  snapshot->max_pages = memory->max_pages;
+  snapshot->fd = create_snapshot_file();
+  if (snapshot->fd < 0 || ftruncate(snapshot->fd, memory->size) != 0) {
+    perror("failed to create memory snapshot");
+    abort();
+  }
+  /* The file starts out as zeroes, so only pages with data need writing. This
+   * keeps the image sparse for mostly-empty memories. */
+  uint32_t i;
+  for (i = 0; i < memory->pages; ++i) {
+    const uint8_t* page = memory->data + (uint64_t)i * PAGE_SIZE;
+    if (is_zero_page(page))
+      continue;
+    if (pwrite(snapshot->fd, page, PAGE_SIZE, (off_t)i * PAGE_SIZE) !=
+        PAGE_SIZE) {
+      perror("failed to write memory snapshot");
+      abort();
+    }
+  }
+}
+
+void wasm_rt_allocate_memory_from_snapshot(
+    wasm_rt_memory_t* memory,
+    const wasm_rt_memory_snapshot_t* snapshot) {
+  allocate_reservation(memory, snapshot->pages, snapshot->max_pages);
+  if (memory->size == 0)
+    return;
+  /* A private file mapping shares the snapshot's pages until they are
+   * written, so this costs the same whatever the size of the memory. */
+  if (mmap(memory->data, memory->size, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_FIXED, snapshot->fd, 0) == MAP_FAILED) {
+    perror("mmap failed");
+    abort();
+  }
+}
+
+void wasm_rt_free_memory_snapshot(wasm_rt_memory_snapshot_t* snapshot) {
+  close(snapshot->fd);
+  snapshot->fd = -1;
+}
+#endif
 
 void wasm_rt_allocate_memory(wasm_rt_memory_t* memory,
                              uint32_t initial_pages,
                              uint32_t max_pages) {
+#if WASM_RT_USE_MMAP
+  allocate_reservation(memory, initial_pages, max_pages);
+  if (!commit_pages(memory->data, 0, initial_pages)) {
+    perror("mprotect failed");
+    abort();
+  }
+#else
   memory->pages = initial_pages;
   memory->max_pages = max_pages;
   memory->size = initial_pages * PAGE_SIZE;
+  memory->reserved_size = memory->size;
+  memory->peak_pages = initial_pages;
+  memory->grow_count = 0;
+  memory->failed_grow_count = 0;
+  memory->grow_ns = 0;
   memory->data = calloc(memory->size, 1);
+#endif
 }
 
-uint32_t wasm_rt_grow_memory(wasm_rt_memory_t* memory, uint32_t delta) {
+static uint32_t grow_memory(wasm_rt_memory_t* memory, uint32_t delta) {
   uint32_t old_pages = memory->pages;
   uint32_t new_pages = memory->pages + delta;
   if (new_pages == 0) {
@@ -110,17 +873,347 @@ uint32_t wasm_rt_grow_memory(wasm_rt_memory_t* memory, uint32_t delta) {
     return (uint32_t)-1;
   }
   uint32_t new_size = new_pages * PAGE_SIZE;
+#if WASM_RT_USE_MMAP
+  uint64_t needed_size = (uint64_t)new_pages * PAGE_SIZE;
+  if (needed_size > memory->reserved_size &&
+      !grow_reservation(memory, needed_size)) {
+    return (uint32_t)-1;
+  }
+  /* The new pages have never been accessible, so they are still zero and
+   * only need to be committed. `data` stays where it is. */
+  if (!commit_pages(memory->data, old_pages, delta)) {
+    return (uint32_t)-1;
+  }
+#else
   uint8_t* new_data = realloc(memory->data, new_size);
   if (new_data == NULL) {
     return (uint32_t)-1;
   }
+  memset(new_data + old_pages * PAGE_SIZE, 0, delta * PAGE_SIZE);
+  memory->data = new_data;
+  memory->reserved_size = new_size;
+#endif
   memory->pages = new_pages;
   memory->size = new_size;
-  memory->data = new_data;
-  memset(memory->data + old_pages * PAGE_SIZE, 0, delta * PAGE_SIZE);
   return old_pages;
 }
 
+uint32_t wasm_rt_grow_memory(wasm_rt_memory_t* memory, uint32_t delta) {
+  uint64_t start = monotonic_ns();
+  uint32_t old_pages = grow_memory(memory, delta);
+  memory->grow_ns += monotonic_ns() - start;
+  if (old_pages == (uint32_t)-1) {
+    ++memory->failed_grow_count;
+  } else if (delta != 0) {
+    ++memory->grow_count;
+    if (memory->pages > memory->peak_pages)
+      memory->peak_pages = memory->pages;
+  }
+  return old_pages;
+}
+
+/* Whether `n` bytes at `offset` fit in `size`, without overflowing. */
+static bool is_in_bounds(uint32_t offset, uint32_t n, uint32_t size) {
+  return (uint64_t)offset + n <= size;
+}
+
+void wasm_rt_memory_copy(wasm_rt_memory_t* memory,
+                         uint32_t dest,
+                         uint32_t src,
+                         uint32_t n) {
+  if (!is_in_bounds(dest, n, memory->size) ||
+      !is_in_bounds(src, n, memory->size))
+    wasm_rt_trap(WASM_RT_TRAP_OOB);
+  memmove(memory->data + dest, memory->data + src, n);
+}
+
+void wasm_rt_memory_fill(wasm_rt_memory_t* memory,
+                         uint32_t dest,
+                         uint32_t value,
+                         uint32_t n) {
+  if (!is_in_bounds(dest, n, memory->size))
+    wasm_rt_trap(WASM_RT_TRAP_OOB);
+  memset(memory->data + dest, (uint8_t)value, n);
+}
+
+void wasm_rt_memory_init(wasm_rt_memory_t* memory,
+                         uint32_t dest,
+                         const uint8_t* segment,
+                         uint32_t segment_size,
+                         uint32_t src,
+                         uint32_t n) {
+  if (!is_in_bounds(dest, n, memory->size) ||
+      !is_in_bounds(src, n, segment_size))
+    wasm_rt_trap(WASM_RT_TRAP_OOB);
+  memcpy(memory->data + dest, segment + src, n);
+}
+
+void wasm_rt_free_memory(wasm_rt_memory_t* memory) {
+#if WASM_RT_USE_MMAP
+#if WASM_RT_MEMCHECK_SIGNAL_HANDLER
+  pthread_mutex_lock(&g_memory_reservations_mutex);
+  MemoryReservation* reservation;
+  for (reservation = g_memory_reservations; reservation;
+       reservation = reservation->next) {
+    if (reservation->base == memory->data)
+      reservation->base = NULL;
+  }
+  pthread_mutex_unlock(&g_memory_reservations_mutex);
+#endif
+  munmap(memory->data, memory->reserved_size);
+  free(memory->file_maps);
+  memory->file_maps = NULL;
+  memory->file_map_count = 0;
+#else
+  free(memory->data);
+#endif
+  memory->data = NULL;
+  memory->pages = memory->size = 0;
+  memory->reserved_size = 0;
+}
+
+#if WASM_RT_USE_MMAP
+static uint64_t resident_size(const uint8_t* data, uint64_t size) {
+  uint64_t host_page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t host_pages = size / host_page_size;
+  uint64_t resident_pages = 0;
+  unsigned char vec[4096];
+  uint64_t first, i;
+  for (first = 0; first < host_pages; first += sizeof(vec)) {
+    uint64_t count = host_pages - first;
+    if (count > sizeof(vec))
+      count = sizeof(vec);
+    if (mincore((void*)(data + first * host_page_size),
+                count * host_page_size, (void*)vec) != 0) {
+      return size;
+    }
+    for (i = 0; i < count; ++i)
+      resident_pages += vec[i] & 1;
+  }
+  return resident_pages * host_page_size;
+}
+
+#ifdef __linux__
+#define PAGEMAP_PRESENT (1ull << 63)
+#define PAGEMAP_SWAPPED (1ull << 62)
+#define PAGEMAP_FILE_OR_SHARED (1ull << 61)
+#define PAGEMAP_EXCLUSIVE (1ull << 56)
+
+static int g_pagemap_fd = -1;
+
+static void open_pagemap(void) {
+  g_pagemap_fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+}
+#endif
+
+/* Bytes of `data` in pages the memory has written to: anonymous pages mapped
+ * only here, which includes its own copies of snapshot pages but not the
+ * shared snapshot pages or zero page it has only read. Without
+ * /proc/self/pagemap, every resident page is counted instead, an upper
+ * bound. */
+static uint64_t dirty_size(const uint8_t* data, uint64_t size) {
+#ifdef __linux__
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  uint64_t host_page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t host_pages = size / host_page_size;
+  uint64_t first_entry = (uintptr_t)data / host_page_size;
+  uint64_t dirty_pages = 0;
+  uint64_t entries[512];
+  uint64_t first, i;
+  pthread_once(&once, open_pagemap);
+  if (g_pagemap_fd < 0)
+    return resident_size(data, size);
+  for (first = 0; first < host_pages; first += 512) {
+    uint64_t count = host_pages - first;
+    if (count > 512)
+      count = 512;
+    if (pread(g_pagemap_fd, entries, count * sizeof(uint64_t),
+              (off_t)((first_entry + first) * sizeof(uint64_t))) !=
+        (ssize_t)(count * sizeof(uint64_t))) {
+      return resident_size(data, size);
+    }
+    for (i = 0; i < count; ++i) {
+      uint64_t entry = entries[i];
+      if ((entry & PAGEMAP_SWAPPED) ||
+          ((entry & PAGEMAP_PRESENT) && (entry & PAGEMAP_EXCLUSIVE) &&
+           !(entry & PAGEMAP_FILE_OR_SHARED))) {
+        ++dirty_pages;
+      }
+    }
+  }
+  return dirty_pages * host_page_size;
+#else
+  return resident_size(data, size);
+#endif
+}
+#endif
+
+uint64_t wasm_rt_memory_resident_size(const wasm_rt_memory_t* memory) {
+#if WASM_RT_USE_MMAP
+  return resident_size(memory->data, memory->size);
+#else
+  return memory->size;
+#endif
+}
+
+void wasm_rt_memory_get_stats(const wasm_rt_memory_t* memory,
+                              wasm_rt_memory_stats_t* stats) {
+  stats->pages = memory->pages;
+  stats->max_pages = memory->max_pages;
+  stats->peak_pages = memory->peak_pages;
+  stats->resident_size = wasm_rt_memory_resident_size(memory);
+  stats->grow_count = memory->grow_count;
+  stats->failed_grow_count = memory->failed_grow_count;
+  stats->grow_ns = memory->grow_ns;
+}
+
+uint64_t wasm_rt_reset_memory(wasm_rt_memory_t* memory, uint32_t pages) {
+  uint64_t reset_size;
+  if (pages > memory->pages)
+    pages = memory->pages;
+#if WASM_RT_USE_MMAP
+  unmap_files(memory);
+  /* Only pages that were written to need dropping: afterwards they read as
+   * zero again, or as the snapshot for a memory allocated from one. */
+  reset_size = dirty_size(memory->data, memory->size);
+  if (reset_size != 0 &&
+      madvise(memory->data, memory->size, MADV_DONTNEED) != 0) {
+    perror("madvise failed");
+    abort();
+  }
+  if (pages < memory->pages &&
+      mprotect(memory->data + (uint64_t)pages * PAGE_SIZE,
+               (uint64_t)(memory->pages - pages) * PAGE_SIZE,
+               PROT_NONE) != 0) {
+    perror("mprotect failed");
+    abort();
+  }
+#else
+  reset_size = memory->size;
+  memset(memory->data, 0, (uint64_t)pages * PAGE_SIZE);
+  if (pages < memory->pages) {
+    uint8_t* new_data = realloc(memory->data, (uint64_t)pages * PAGE_SIZE);
+    if (new_data != NULL || pages == 0)
+      memory->data = new_data;
+    memory->reserved_size = (uint64_t)pages * PAGE_SIZE;
+  }
+#endif
+  memory->pages = pages;
+  memory->size = pages * PAGE_SIZE;
+  return reset_size;
+}
+
+#if WASM_RT_USE_MMAP
+/* The host pages from `dest` covering `size` bytes, if `dest` is aligned
+ * and they lie inside `memory`; 0 otherwise. */
+static uint64_t file_map_length(const wasm_rt_memory_t* memory,
+                                uint32_t dest,
+                                uint32_t size) {
+  uint64_t host_page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t length =
+      ((uint64_t)size + host_page_size - 1) & ~(host_page_size - 1);
+  if (size == 0 || dest % PAGE_SIZE != 0 || dest + length > memory->size)
+    return 0;
+  return length;
+}
+
+int wasm_rt_memory_map_file(wasm_rt_memory_t* memory,
+                            uint32_t dest,
+                            int fd,
+                            uint64_t offset,
+                            uint32_t size) {
+  uint64_t length = file_map_length(memory, dest, size);
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0)
+    return -1;
+  if (length == 0 || offset % (uint64_t)sysconf(_SC_PAGESIZE) != 0 ||
+      offset + size > (uint64_t)file_stat.st_size) {
+    errno = EINVAL;
+    return -1;
+  }
+  /* MAP_FIXED swaps the pages in for the anonymous ones atomically. The
+   * mapping is private so that nothing can write through to the file. */
+  wasm_rt_file_map_t* maps = realloc(
+      memory->file_maps,
+      (memory->file_map_count + 1) * sizeof(wasm_rt_file_map_t));
+  if (maps == NULL)
+    return -1;
+  memory->file_maps = maps;
+  if (mmap(memory->data + dest, length, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+           fd, (off_t)offset) == MAP_FAILED)
+    return -1;
+  maps[memory->file_map_count].dest = dest;
+  maps[memory->file_map_count].length = length;
+  ++memory->file_map_count;
+  return 0;
+}
+
+int wasm_rt_memory_unmap_file(wasm_rt_memory_t* memory,
+                              uint32_t dest,
+                              uint32_t size) {
+  uint64_t length = file_map_length(memory, dest, size);
+  if (length == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  uint32_t i;
+  for (i = 0; i < memory->file_map_count; ++i) {
+    if (memory->file_maps[i].dest == dest &&
+        memory->file_maps[i].length == length)
+      break;
+  }
+  if (i == memory->file_map_count) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (!map_zero_pages(memory->data + dest, length))
+    return -1;
+  memory->file_maps[i] = memory->file_maps[--memory->file_map_count];
+  return 0;
+}
+#endif
+
+#if WASM_RT_DISPATCH_TABLES
+/* Stands in for null and padding elements, so that even a call that skips the
+ * type check traps instead of jumping to address 0. */
+static void trap_null_element(void) {
+  wasm_rt_trap(WASM_RT_TRAP_CALL_INDIRECT);
+}
+
+void wasm_rt_allocate_table(wasm_rt_table_t* table,
+                            uint32_t elements,
+                            uint32_t max_elements) {
+  uint32_t capacity = 1;
+  while (capacity < elements)
+    capacity <<= 1;
+  table->size = elements;
+  table->max_size = max_elements;
+  table->mask = capacity - 1;
+  table->func_types = calloc(capacity, sizeof(uint32_t));
+  table->funcs = malloc(capacity * sizeof(wasm_rt_anyfunc_t));
+  uint32_t i;
+  for (i = 0; i < capacity; ++i)
+    table->funcs[i] = trap_null_element;
+}
+
+void wasm_rt_table_set(wasm_rt_table_t* table,
+                       uint32_t index,
+                       uint32_t func_type,
+                       wasm_rt_anyfunc_t func) {
+  assert(index < table->size);
+  table->func_types[index] = func ? func_type : 0;
+  table->funcs[index] = func ? func : trap_null_element;
+}
+
+void wasm_rt_free_table(wasm_rt_table_t* table) {
+  free(table->func_types);
+  free(table->funcs);
+  table->func_types = NULL;
+  table->funcs = NULL;
+  table->size = 0;
+  table->mask = 0;
+}
+#else
 void wasm_rt_allocate_table(wasm_rt_table_t* table,
                             uint32_t elements,
                             uint32_t max_elements) {
@@ -128,3 +1221,296 @@ void wasm_rt_allocate_table(wasm_rt_table_t* table,
   table->max_size = max_elements;
   table->data = calloc(table->size, sizeof(wasm_rt_elem_t));
 }
+
+void wasm_rt_table_set(wasm_rt_table_t* table,
+                       uint32_t index,
+                       uint32_t func_type,
+                       wasm_rt_anyfunc_t func) {
+  assert(index < table->size);
+  table->data[index].func_type = func_type;
+  table->data[index].func = func;
+}
+
+void wasm_rt_free_table(wasm_rt_table_t* table) {
+  free(table->data);
+  table->data = NULL;
+  table->size = 0;
+}
+#endif
+
+#if WASM_RT_PROFILE
+/* A calling context: a function, and the chain of calls that led to it. Each
+ * thread has its own tree of these, whose root has no function. */
+typedef struct ProfileNode {
+  wasm_rt_profile_func_t* func;
+  struct ProfileNode* parent;
+  struct ProfileNode* first_child;
+  /* The parent's next child, or for a root, the next thread's root. */
+  struct ProfileNode* next_sibling;
+  uint64_t calls;
+  /* Ticks spent in this context, and in the contexts it called. */
+  uint64_t ticks;
+  uint64_t child_ticks;
+  /* When this context was last entered. */
+  uint64_t start;
+} ProfileNode;
+
+/* Per function totals, gathered when the profile is written. */
+typedef struct ProfileSummary {
+  wasm_rt_profile_func_t* func;
+  uint64_t calls;
+  uint64_t inclusive_ticks;
+  uint64_t exclusive_ticks;
+  /* How many contexts of the function enclose the one being visited, so that
+   * recursive calls are not counted twice in the inclusive time. */
+  uint32_t open;
+} ProfileSummary;
+
+WASM_RT_THREAD_LOCAL void* wasm_rt_profile_context;
+static WASM_RT_THREAD_LOCAL ProfileNode* g_profile_root;
+
+/* Guards the links between nodes, g_profile_roots and g_profile_funcs. Counts
+ * and times are only written by the thread that owns the node. */
+static pthread_mutex_t g_profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_profile_once = PTHREAD_ONCE_INIT;
+static ProfileNode* g_profile_roots;
+/* Every function seen so far, indexed by `id - 1`. */
+static wasm_rt_profile_func_t** g_profile_funcs;
+static uint32_t g_profile_func_count;
+static uint32_t g_profile_func_capacity;
+/* When profiling started, to convert ticks to nanoseconds. */
+static uint64_t g_profile_start_ticks;
+static uint64_t g_profile_start_ns;
+
+static inline uint64_t profile_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t ticks;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  return monotonic_ns();
+#endif
+}
+
+static void dump_profile_at_exit(void) {
+  const char* path_prefix = getenv("WASM_RT_PROFILE_OUT");
+  if (wasm_rt_profile_dump(path_prefix ? path_prefix : "wasm-rt-profile") != 0)
+    perror("wasm_rt_profile_dump failed");
+}
+
+static void start_profile(void) {
+  g_profile_start_ns = monotonic_ns();
+  g_profile_start_ticks = profile_ticks();
+  atexit(dump_profile_at_exit);
+}
+
+static ProfileNode* profile_root(void) {
+  if (!g_profile_root) {
+    ProfileNode* root = calloc(1, sizeof(ProfileNode));
+    if (!root) {
+      perror("calloc failed");
+      abort();
+    }
+    pthread_once(&g_profile_once, start_profile);
+    pthread_mutex_lock(&g_profile_mutex);
+    root->next_sibling = g_profile_roots;
+    g_profile_roots = root;
+    pthread_mutex_unlock(&g_profile_mutex);
+    g_profile_root = root;
+  }
+  return g_profile_root;
+}
+
+static ProfileNode* add_profile_node(ProfileNode* parent,
+                                     wasm_rt_profile_func_t* func) {
+  ProfileNode* node = calloc(1, sizeof(ProfileNode));
+  if (!node) {
+    perror("calloc failed");
+    abort();
+  }
+  node->func = func;
+  node->parent = parent;
+  pthread_mutex_lock(&g_profile_mutex);
+  if (!func->id) {
+    if (g_profile_func_count == g_profile_func_capacity) {
+      g_profile_func_capacity =
+          g_profile_func_capacity ? g_profile_func_capacity * 2 : 64;
+      g_profile_funcs =
+          realloc(g_profile_funcs,
+                  g_profile_func_capacity * sizeof(wasm_rt_profile_func_t*));
+      if (!g_profile_funcs) {
+        perror("realloc failed");
+        abort();
+      }
+    }
+    g_profile_funcs[g_profile_func_count] = func;
+    func->id = ++g_profile_func_count;
+  }
+  node->next_sibling = parent->first_child;
+  parent->first_child = node;
+  pthread_mutex_unlock(&g_profile_mutex);
+  return node;
+}
+
+void wasm_rt_profile_enter(wasm_rt_profile_func_t* func) {
+  ProfileNode* parent = wasm_rt_profile_context;
+  ProfileNode* node;
+  if (!parent)
+    parent = profile_root();
+  for (node = parent->first_child; node && node->func != func;
+       node = node->next_sibling) {
+  }
+  if (!node)
+    node = add_profile_node(parent, func);
+  ++node->calls;
+  wasm_rt_profile_context = node;
+  node->start = profile_ticks();
+}
+
+void wasm_rt_profile_exit(void) {
+  uint64_t now = profile_ticks();
+  ProfileNode* node = wasm_rt_profile_context;
+  uint64_t ticks;
+  if (!node || !node->func)
+    return;
+  ticks = now - node->start;
+  node->ticks += ticks;
+  node->parent->child_ticks += ticks;
+  wasm_rt_profile_context = node->parent;
+}
+
+/* Write one folded stack line for `node` and each context below it. */
+static void write_folded(FILE* file,
+                         const ProfileNode* node,
+                         const ProfileNode** path,
+                         uint32_t depth,
+                         double ns_per_tick) {
+  const ProfileNode* child;
+  uint64_t exclusive = node->ticks - node->child_ticks;
+  uint32_t i;
+  path[depth++] = node;
+  if (node->ticks > node->child_ticks) {
+    for (i = 0; i < depth; ++i) {
+      if (i)
+        fputc(';', file);
+      fprintf(file, "%s%s", path[i]->func->module, path[i]->func->name);
+    }
+    fprintf(file, " %llu\n",
+            (unsigned long long)((double)exclusive * ns_per_tick + 0.5));
+  }
+  for (child = node->first_child; child; child = child->next_sibling)
+    write_folded(file, child, path, depth, ns_per_tick);
+}
+
+static uint32_t tree_depth(const ProfileNode* node) {
+  const ProfileNode* child;
+  uint32_t depth = 0;
+  for (child = node->first_child; child; child = child->next_sibling) {
+    uint32_t child_depth = tree_depth(child);
+    if (child_depth > depth)
+      depth = child_depth;
+  }
+  return depth + 1;
+}
+
+static void summarize(ProfileSummary* summaries, const ProfileNode* node) {
+  ProfileSummary* summary = &summaries[node->func->id - 1];
+  const ProfileNode* child;
+  summary->calls += node->calls;
+  summary->exclusive_ticks += node->ticks - node->child_ticks;
+  if (!summary->open)
+    summary->inclusive_ticks += node->ticks;
+  ++summary->open;
+  for (child = node->first_child; child; child = child->next_sibling)
+    summarize(summaries, child);
+  --summary->open;
+}
+
+static int compare_summaries(const void* a, const void* b) {
+  const ProfileSummary* x = a;
+  const ProfileSummary* y = b;
+  return x->exclusive_ticks < y->exclusive_ticks
+             ? 1
+             : x->exclusive_ticks > y->exclusive_ticks ? -1 : 0;
+}
+
+static FILE* open_profile_file(const char* path_prefix, const char* suffix) {
+  size_t length = strlen(path_prefix);
+  char* path = malloc(length + strlen(suffix) + 1);
+  FILE* file;
+  if (!path)
+    return NULL;
+  memcpy(path, path_prefix, length);
+  strcpy(path + length, suffix);
+  file = fopen(path, "w");
+  free(path);
+  return file;
+}
+
+int wasm_rt_profile_dump(const char* path_prefix) {
+  FILE* folded = open_profile_file(path_prefix, ".folded");
+  FILE* summary = open_profile_file(path_prefix, ".txt");
+  ProfileSummary* summaries = NULL;
+  const ProfileNode** path = NULL;
+  const ProfileNode* root;
+  const ProfileNode* node;
+  double ns_per_tick = 1;
+  uint64_t elapsed_ticks;
+  uint32_t depth = 0;
+  uint32_t i;
+  int result = -1;
+
+  if (!folded || !summary)
+    goto done;
+  pthread_mutex_lock(&g_profile_mutex);
+  elapsed_ticks = profile_ticks() - g_profile_start_ticks;
+  if (g_profile_start_ns && elapsed_ticks)
+    ns_per_tick = (double)(monotonic_ns() - g_profile_start_ns) / elapsed_ticks;
+  for (root = g_profile_roots; root; root = root->next_sibling) {
+    uint32_t root_depth = tree_depth(root);
+    if (root_depth > depth)
+      depth = root_depth;
+  }
+  summaries = calloc(g_profile_func_count + 1, sizeof(ProfileSummary));
+  path = malloc((depth + 1) * sizeof(ProfileNode*));
+  if (summaries && path) {
+    for (root = g_profile_roots; root; root = root->next_sibling) {
+      for (node = root->first_child; node; node = node->next_sibling) {
+        write_folded(folded, node, path, 0, ns_per_tick);
+        summarize(summaries, node);
+      }
+    }
+    for (i = 0; i < g_profile_func_count; ++i)
+      summaries[i].func = g_profile_funcs[i];
+  }
+  pthread_mutex_unlock(&g_profile_mutex);
+  if (!summaries || !path)
+    goto done;
+
+  qsort(summaries, g_profile_func_count, sizeof(ProfileSummary),
+        compare_summaries);
+  fprintf(summary, "%-32s %12s %16s %16s\n", "function", "calls",
+          "inclusive_ns", "exclusive_ns");
+  for (i = 0; i < g_profile_func_count; ++i) {
+    char name[256];
+    snprintf(name, sizeof(name), "%s%s", summaries[i].func->module,
+             summaries[i].func->name);
+    fprintf(summary, "%-32s %12llu %16.0f %16.0f\n", name,
+            (unsigned long long)summaries[i].calls,
+            (double)summaries[i].inclusive_ticks * ns_per_tick,
+            (double)summaries[i].exclusive_ticks * ns_per_tick);
+  }
+  result = 0;
+
+done:
+  free(summaries);
+  free(path);
+  if (folded && fclose(folded) != 0)
+    result = -1;
+  if (summary && fclose(summary) != 0)
+    result = -1;
+  return result;
+}
+#endif
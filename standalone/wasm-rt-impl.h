@@ -25,11 +25,21 @@
 extern "C" {
 #endif
 
-/** A setjmp buffer used for handling traps. */
-extern jmp_buf g_jmp_buf;
+/** A setjmp buffer used for handling traps. Each thread has its own. */
+extern WASM_RT_THREAD_LOCAL jmp_buf g_jmp_buf;
 
 /** Saved call stack depth that will be restored in case a trap occurs. */
-extern uint32_t g_saved_call_stack_depth;
+extern WASM_RT_THREAD_LOCAL uint32_t g_saved_call_stack_depth;
+
+/** Saved profiler context that will be restored in case a trap occurs. */
+extern WASM_RT_THREAD_LOCAL void* g_saved_profile_context;
+
+#if WASM_RT_PROFILE
+#define WASM_RT_IMPL_SAVE_PROFILE_CONTEXT(dest) \
+  (dest) = wasm_rt_profile_context,
+#else
+#define WASM_RT_IMPL_SAVE_PROFILE_CONTEXT(dest)
+#endif
 
 /** Convenience macro to use before calling a wasm function. On first execution
  * it will return `WASM_RT_TRAP_NONE` (i.e. 0). If the function traps, it will
@@ -45,9 +55,50 @@ extern uint32_t g_saved_call_stack_depth;
  *   // Call the potentially-trapping function.
  *   my_wasm_func();
  * ```
+ *
+ * There is one such handler per thread, and each call replaces the last one.
+ * Use `wasm_rt_impl_try_scope` where calls into wasm can nest.
  */
-#define wasm_rt_impl_try() \
-  (g_saved_call_stack_depth = wasm_rt_call_stack_depth, setjmp(g_jmp_buf))
+#define wasm_rt_impl_try()                                     \
+  (g_saved_call_stack_depth = wasm_rt_call_stack_depth,        \
+   WASM_RT_IMPL_SAVE_PROFILE_CONTEXT(g_saved_profile_context) \
+   setjmp(g_jmp_buf))
+
+/** A trap handler that can be nested, typically kept on the stack of the
+ * function that calls into wasm. */
+typedef struct wasm_rt_try_scope_t {
+  jmp_buf buf;
+  uint32_t saved_call_stack_depth;
+  void* saved_profile_context;
+  struct wasm_rt_try_scope_t* prev;
+} wasm_rt_try_scope_t;
+
+/** The innermost open try scope of the calling thread, or NULL. A trap jumps
+ * here if set, and to `g_jmp_buf` otherwise. */
+extern WASM_RT_THREAD_LOCAL wasm_rt_try_scope_t* g_try_scope;
+
+/** Like `wasm_rt_impl_try`, but opens a scope that must be closed with
+ * `wasm_rt_impl_end_try_scope` on every path, trap or not. A trap inside the
+ * scope returns to it even if the wasm code was called from a host function
+ * that was itself called from wasm inside an outer scope.
+ *
+ * ```
+ *   wasm_rt_try_scope_t scope;
+ *   wasm_rt_trap_t code = wasm_rt_impl_try_scope(&scope);
+ *   if (code == 0) {
+ *     my_wasm_func();
+ *   }
+ *   wasm_rt_impl_end_try_scope(&scope);
+ * ```
+ */
+#define wasm_rt_impl_try_scope(scope)                                  \
+  ((scope)->saved_call_stack_depth = wasm_rt_call_stack_depth,         \
+   WASM_RT_IMPL_SAVE_PROFILE_CONTEXT((scope)->saved_profile_context)  \
+   (scope)->prev = g_try_scope, g_try_scope = (scope),                 \
+   setjmp((scope)->buf))
+
+/** Close a scope opened by `wasm_rt_impl_try_scope`. */
+#define wasm_rt_impl_end_try_scope(scope) (g_try_scope = (scope)->prev)
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,981 @@
+/*
+ * Copyright 2018 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WASM_RT_SIMD_H_
+#define WASM_RT_SIMD_H_
+
+/* The SIMD instructions on `wasm_rt_v128` values, for generated code to
+ * include when the module uses them. Each instruction is a function (or, when
+ * it takes lane immediates, a macro) named after it, so `i32x4.add` is
+ * `i32x4_add`.
+ *
+ * Most instructions are written with GCC/Clang vector extensions, which the
+ * compiler maps onto NEON on ARM and SSE on x86, and onto scalar code on
+ * targets without SIMD, such as ARMv6. Instructions that the vector extensions
+ * can't express well use NEON or SSE intrinsics directly, with a scalar
+ * fallback. Defining `WASM_RT_SIMD_SCALAR` to 1 forces the fallbacks.
+ *
+ * Memory accesses are `v128_load` and `v128_store` in the generated code; the
+ * splat, extend and zero variants of `v128.load` are a scalar load followed by
+ * the matching instruction here, such as `i32x4_splat(i32_load(mem, addr))`.
+ * The lane variants are macros here that expand to the same, using the
+ * generated code's scalar loads and stores.
+ *
+ * Lanes are numbered as in memory, which assumes a little-endian host, as
+ * wasm2c does everywhere else. */
+
+#include <math.h>
+#include <stdint.h>
+
+#include "wasm-rt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef WASM_RT_SIMD_SCALAR
+#define WASM_RT_SIMD_SCALAR 0
+#endif
+
+#if !WASM_RT_SIMD_SCALAR && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define WASM_RT_SIMD_NEON 1
+#if defined(__aarch64__)
+#define WASM_RT_SIMD_NEON64 1
+#endif
+#elif !WASM_RT_SIMD_SCALAR && defined(__SSE2__)
+#include <emmintrin.h>
+#define WASM_RT_SIMD_SSE2 1
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#endif
+
+typedef int8_t wasm_rt_i8x16 __attribute__((vector_size(16)));
+typedef uint8_t wasm_rt_u8x16 __attribute__((vector_size(16)));
+typedef int16_t wasm_rt_i16x8 __attribute__((vector_size(16)));
+typedef uint16_t wasm_rt_u16x8 __attribute__((vector_size(16)));
+typedef int32_t wasm_rt_i32x4 __attribute__((vector_size(16)));
+typedef uint32_t wasm_rt_u32x4 __attribute__((vector_size(16)));
+typedef int64_t wasm_rt_i64x2 __attribute__((vector_size(16)));
+typedef uint64_t wasm_rt_u64x2 __attribute__((vector_size(16)));
+typedef float wasm_rt_f32x4 __attribute__((vector_size(16)));
+typedef double wasm_rt_f64x2 __attribute__((vector_size(16)));
+
+#define SIMD_INLINE static inline __attribute__((always_inline))
+
+/* Casts between vector types of the same size reinterpret the bits. */
+#define SIMD_AS(lanes, v) ((wasm_rt_##lanes)(v))
+#define SIMD_V128(v) ((wasm_rt_v128)(v))
+
+/* Lanes of `a` where `mask` is all ones, else lanes of `b`. */
+SIMD_INLINE wasm_rt_v128 simd_select(wasm_rt_v128 mask,
+                                     wasm_rt_v128 a,
+                                     wasm_rt_v128 b) {
+  return (a & mask) | (b & ~mask);
+}
+
+/* Helpers for the scalar fallbacks, following the scalar instructions. */
+
+SIMD_INLINE float simd_fminf(float a, float b) {
+  if (isnan(a) || isnan(b))
+    return NAN;
+  if (a == b)
+    return signbit(a) ? a : b;
+  return a < b ? a : b;
+}
+
+SIMD_INLINE float simd_fmaxf(float a, float b) {
+  if (isnan(a) || isnan(b))
+    return NAN;
+  if (a == b)
+    return signbit(a) ? b : a;
+  return a > b ? a : b;
+}
+
+SIMD_INLINE double simd_fmin(double a, double b) {
+  if (isnan(a) || isnan(b))
+    return NAN;
+  if (a == b)
+    return signbit(a) ? a : b;
+  return a < b ? a : b;
+}
+
+SIMD_INLINE double simd_fmax(double a, double b) {
+  if (isnan(a) || isnan(b))
+    return NAN;
+  if (a == b)
+    return signbit(a) ? b : a;
+  return a > b ? a : b;
+}
+
+SIMD_INLINE int32_t simd_trunc_sat_s32(double x) {
+  if (isnan(x))
+    return 0;
+  if (x <= -2147483648.0)
+    return INT32_MIN;
+  if (x >= 2147483648.0)
+    return INT32_MAX;
+  return (int32_t)x;
+}
+
+SIMD_INLINE uint32_t simd_trunc_sat_u32(double x) {
+  if (!(x > -1.0))
+    return 0;
+  if (x >= 4294967296.0)
+    return UINT32_MAX;
+  return (uint32_t)x;
+}
+
+SIMD_INLINE int32_t simd_saturate(int32_t x, int32_t min, int32_t max) {
+  return x < min ? min : x > max ? max : x;
+}
+
+/* Splats. Integer splats broadcast by adding to zero; float ones can't, as
+ * 0 + -0 is +0. */
+
+SIMD_INLINE wasm_rt_v128 i8x16_splat(uint32_t x) {
+  return SIMD_V128((wasm_rt_i8x16){0} + (int8_t)x);
+}
+
+SIMD_INLINE wasm_rt_v128 i16x8_splat(uint32_t x) {
+  return SIMD_V128((wasm_rt_i16x8){0} + (int16_t)x);
+}
+
+SIMD_INLINE wasm_rt_v128 i32x4_splat(uint32_t x) {
+  return SIMD_V128((wasm_rt_i32x4){0} + (int32_t)x);
+}
+
+SIMD_INLINE wasm_rt_v128 i64x2_splat(uint64_t x) {
+  return (wasm_rt_v128){0} + (int64_t)x;
+}
+
+SIMD_INLINE wasm_rt_v128 f32x4_splat(float x) {
+  return SIMD_V128(((wasm_rt_f32x4){x, x, x, x}));
+}
+
+SIMD_INLINE wasm_rt_v128 f64x2_splat(double x) {
+  return SIMD_V128(((wasm_rt_f64x2){x, x}));
+}
+
+/* Lane access. `lane` must be a constant, as it is in the instruction. */
+
+#define i8x16_extract_lane_s(v, lane) \
+  ((uint32_t)(int32_t)SIMD_AS(i8x16, v)[lane])
+#define i8x16_extract_lane_u(v, lane) ((uint32_t)SIMD_AS(u8x16, v)[lane])
+#define i16x8_extract_lane_s(v, lane) \
+  ((uint32_t)(int32_t)SIMD_AS(i16x8, v)[lane])
+#define i16x8_extract_lane_u(v, lane) ((uint32_t)SIMD_AS(u16x8, v)[lane])
+#define i32x4_extract_lane(v, lane) ((uint32_t)SIMD_AS(u32x4, v)[lane])
+#define i64x2_extract_lane(v, lane) ((uint64_t)SIMD_AS(u64x2, v)[lane])
+#define f32x4_extract_lane(v, lane) (SIMD_AS(f32x4, v)[lane])
+#define f64x2_extract_lane(v, lane) (SIMD_AS(f64x2, v)[lane])
+
+#define SIMD_REPLACE_LANE(name, lanes, t)                                 \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 v, int lane, t x) {         \
+    wasm_rt_##lanes result = SIMD_AS(lanes, v);                          \
+    result[lane] = x;                                                    \
+    return SIMD_V128(result);                                            \
+  }
+
+SIMD_REPLACE_LANE(i8x16_replace_lane, u8x16, uint32_t)
+SIMD_REPLACE_LANE(i16x8_replace_lane, u16x8, uint32_t)
+SIMD_REPLACE_LANE(i32x4_replace_lane, u32x4, uint32_t)
+SIMD_REPLACE_LANE(i64x2_replace_lane, u64x2, uint64_t)
+SIMD_REPLACE_LANE(f32x4_replace_lane, f32x4, float)
+SIMD_REPLACE_LANE(f64x2_replace_lane, f64x2, double)
+
+/* v128.load*_lane and v128.store*_lane, for generated code: they use its
+ * scalar loads and stores, and so its bounds checks. */
+#define v128_load8_lane(mem, addr, v, lane) \
+  i8x16_replace_lane(v, lane, i32_load8_u(mem, addr))
+#define v128_load16_lane(mem, addr, v, lane) \
+  i16x8_replace_lane(v, lane, i32_load16_u(mem, addr))
+#define v128_load32_lane(mem, addr, v, lane) \
+  i32x4_replace_lane(v, lane, i32_load(mem, addr))
+#define v128_load64_lane(mem, addr, v, lane) \
+  i64x2_replace_lane(v, lane, i64_load(mem, addr))
+#define v128_store8_lane(mem, addr, v, lane) \
+  i32_store8(mem, addr, i8x16_extract_lane_u(v, lane))
+#define v128_store16_lane(mem, addr, v, lane) \
+  i32_store16(mem, addr, i16x8_extract_lane_u(v, lane))
+#define v128_store32_lane(mem, addr, v, lane) \
+  i32_store(mem, addr, i32x4_extract_lane(v, lane))
+#define v128_store64_lane(mem, addr, v, lane) \
+  i64_store(mem, addr, i64x2_extract_lane(v, lane))
+
+/* i8x16.shuffle; `c0`..`c15` must be constants below 32. */
+#if defined(__clang__)
+#define i8x16_shuffle(a, b, c0, c1, c2, c3, c4, c5, c6, c7, c8, c9, c10, c11, \
+                      c12, c13, c14, c15)                                    \
+  SIMD_V128(__builtin_shufflevector(SIMD_AS(i8x16, a), SIMD_AS(i8x16, b), c0, \
+                                    c1, c2, c3, c4, c5, c6, c7, c8, c9, c10,  \
+                                    c11, c12, c13, c14, c15))
+#else
+#define i8x16_shuffle(a, b, c0, c1, c2, c3, c4, c5, c6, c7, c8, c9, c10, c11, \
+                      c12, c13, c14, c15)                                    \
+  SIMD_V128(__builtin_shuffle(                                                \
+      SIMD_AS(i8x16, a), SIMD_AS(i8x16, b),                                   \
+      ((wasm_rt_i8x16){c0, c1, c2, c3, c4, c5, c6, c7, c8, c9, c10, c11, c12, \
+                       c13, c14, c15})))
+#endif
+
+SIMD_INLINE wasm_rt_v128 i8x16_swizzle(wasm_rt_v128 a, wasm_rt_v128 s) {
+#if WASM_RT_SIMD_NEON64
+  return SIMD_V128(vqtbl1q_u8((uint8x16_t)a, (uint8x16_t)s));
+#elif WASM_RT_SIMD_NEON
+  /* vtbl gives 0 for out of range indices, as swizzle does. */
+  uint8x8x2_t table = {{vget_low_u8((uint8x16_t)a),
+                        vget_high_u8((uint8x16_t)a)}};
+  return SIMD_V128(vcombine_u8(vtbl2_u8(table, vget_low_u8((uint8x16_t)s)),
+                               vtbl2_u8(table, vget_high_u8((uint8x16_t)s))));
+#elif WASM_RT_SIMD_SSE2 && defined(__SSSE3__)
+  /* pshufb gives 0 only where the top bit of the index is set; saturating
+   * the indices at 0x70 sets it for every index above 15. */
+  __m128i indices = _mm_adds_epu8((__m128i)s, _mm_set1_epi8(0x70));
+  return SIMD_V128(_mm_shuffle_epi8((__m128i)a, indices));
+#else
+  wasm_rt_u8x16 bytes = SIMD_AS(u8x16, a), indices = SIMD_AS(u8x16, s);
+  wasm_rt_u8x16 result;
+  int i;
+  for (i = 0; i < 16; ++i)
+    result[i] = indices[i] < 16 ? bytes[indices[i]] : 0;
+  return SIMD_V128(result);
+#endif
+}
+
+/* Bitwise operations. */
+
+SIMD_INLINE wasm_rt_v128 v128_not(wasm_rt_v128 a) {
+  return ~a;
+}
+
+SIMD_INLINE wasm_rt_v128 v128_and(wasm_rt_v128 a, wasm_rt_v128 b) {
+  return a & b;
+}
+
+SIMD_INLINE wasm_rt_v128 v128_andnot(wasm_rt_v128 a, wasm_rt_v128 b) {
+  return a & ~b;
+}
+
+SIMD_INLINE wasm_rt_v128 v128_or(wasm_rt_v128 a, wasm_rt_v128 b) {
+  return a | b;
+}
+
+SIMD_INLINE wasm_rt_v128 v128_xor(wasm_rt_v128 a, wasm_rt_v128 b) {
+  return a ^ b;
+}
+
+SIMD_INLINE wasm_rt_v128 v128_bitselect(wasm_rt_v128 a,
+                                        wasm_rt_v128 b,
+                                        wasm_rt_v128 c) {
+  return simd_select(c, a, b);
+}
+
+SIMD_INLINE uint32_t v128_any_true(wasm_rt_v128 a) {
+  return (a[0] | a[1]) != 0;
+}
+
+/* all_true is "no lane equals zero". */
+#define SIMD_ALL_TRUE(name, lanes)                                 \
+  SIMD_INLINE uint32_t name(wasm_rt_v128 a) {                      \
+    return !v128_any_true(SIMD_V128(SIMD_AS(lanes, a) == 0));      \
+  }
+
+SIMD_ALL_TRUE(i8x16_all_true, i8x16)
+SIMD_ALL_TRUE(i16x8_all_true, i16x8)
+SIMD_ALL_TRUE(i32x4_all_true, i32x4)
+SIMD_ALL_TRUE(i64x2_all_true, i64x2)
+
+SIMD_INLINE uint32_t i8x16_bitmask(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_SSE2
+  return (uint32_t)_mm_movemask_epi8((__m128i)a);
+#else
+  wasm_rt_u8x16 bytes = SIMD_AS(u8x16, a);
+  uint32_t result = 0;
+  int i;
+  for (i = 0; i < 16; ++i)
+    result |= (uint32_t)(bytes[i] >> 7) << i;
+  return result;
+#endif
+}
+
+SIMD_INLINE uint32_t i16x8_bitmask(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_SSE2
+  return (uint32_t)_mm_movemask_epi8(
+      _mm_packs_epi16((__m128i)a, _mm_setzero_si128()));
+#else
+  wasm_rt_u16x8 lanes = SIMD_AS(u16x8, a);
+  uint32_t result = 0;
+  int i;
+  for (i = 0; i < 8; ++i)
+    result |= (uint32_t)(lanes[i] >> 15) << i;
+  return result;
+#endif
+}
+
+SIMD_INLINE uint32_t i32x4_bitmask(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_SSE2
+  return (uint32_t)_mm_movemask_ps((__m128)a);
+#else
+  wasm_rt_u32x4 lanes = SIMD_AS(u32x4, a);
+  return (lanes[0] >> 31) | (lanes[1] >> 31) << 1 | (lanes[2] >> 31) << 2 |
+         (lanes[3] >> 31) << 3;
+#endif
+}
+
+SIMD_INLINE uint32_t i64x2_bitmask(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_SSE2
+  return (uint32_t)_mm_movemask_pd((__m128d)a);
+#else
+  wasm_rt_u64x2 lanes = SIMD_AS(u64x2, a);
+  return (uint32_t)(lanes[0] >> 63 | (lanes[1] >> 63) << 1);
+#endif
+}
+
+/* Integer arithmetic, comparisons and shifts. Comparisons give all ones in
+ * lanes where they hold, as the vector extensions do. */
+
+#define SIMD_BINARY(name, lanes, op)                                  \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a, wasm_rt_v128 b) {     \
+    return SIMD_V128(SIMD_AS(lanes, a) op SIMD_AS(lanes, b));         \
+  }
+
+#define SIMD_SHIFT(name, lanes, op, bits)                             \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a, uint32_t n) {         \
+    return SIMD_V128(SIMD_AS(lanes, a) op(int)(n & ((bits)-1)));      \
+  }
+
+#define SIMD_MIN_MAX(name, lanes, op)                                 \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a, wasm_rt_v128 b) {     \
+    return simd_select(SIMD_V128(SIMD_AS(lanes, a) op SIMD_AS(lanes, b)), a, \
+                       b);                                            \
+  }
+
+#define SIMD_ABS_NEG(prefix, lanes)                                   \
+  SIMD_INLINE wasm_rt_v128 prefix##_neg(wasm_rt_v128 a) {             \
+    return SIMD_V128(-SIMD_AS(lanes, a));                             \
+  }                                                                   \
+  SIMD_INLINE wasm_rt_v128 prefix##_abs(wasm_rt_v128 a) {             \
+    return simd_select(SIMD_V128(SIMD_AS(lanes, a) < 0),              \
+                       prefix##_neg(a), a);                           \
+  }
+
+#define SIMD_INTEGER_OPS(prefix, s, u, bits)         \
+  SIMD_BINARY(prefix##_add, s, +)                    \
+  SIMD_BINARY(prefix##_sub, s, -)                    \
+  SIMD_BINARY(prefix##_eq, s, ==)                    \
+  SIMD_BINARY(prefix##_ne, s, !=)                    \
+  SIMD_BINARY(prefix##_lt_s, s, <)                   \
+  SIMD_BINARY(prefix##_gt_s, s, >)                   \
+  SIMD_BINARY(prefix##_le_s, s, <=)                  \
+  SIMD_BINARY(prefix##_ge_s, s, >=)                  \
+  SIMD_SHIFT(prefix##_shl, u, <<, bits)              \
+  SIMD_SHIFT(prefix##_shr_s, s, >>, bits)            \
+  SIMD_SHIFT(prefix##_shr_u, u, >>, bits)            \
+  SIMD_ABS_NEG(prefix, s)
+
+#define SIMD_NARROW_INTEGER_OPS(prefix, s, u)        \
+  SIMD_BINARY(prefix##_lt_u, u, <)                   \
+  SIMD_BINARY(prefix##_gt_u, u, >)                   \
+  SIMD_BINARY(prefix##_le_u, u, <=)                  \
+  SIMD_BINARY(prefix##_ge_u, u, >=)                  \
+  SIMD_MIN_MAX(prefix##_min_s, s, <)                 \
+  SIMD_MIN_MAX(prefix##_min_u, u, <)                 \
+  SIMD_MIN_MAX(prefix##_max_s, s, >)                 \
+  SIMD_MIN_MAX(prefix##_max_u, u, >)
+
+SIMD_INTEGER_OPS(i8x16, i8x16, u8x16, 8)
+SIMD_INTEGER_OPS(i16x8, i16x8, u16x8, 16)
+SIMD_INTEGER_OPS(i32x4, i32x4, u32x4, 32)
+SIMD_INTEGER_OPS(i64x2, i64x2, u64x2, 64)
+SIMD_NARROW_INTEGER_OPS(i8x16, i8x16, u8x16)
+SIMD_NARROW_INTEGER_OPS(i16x8, i16x8, u16x8)
+SIMD_NARROW_INTEGER_OPS(i32x4, i32x4, u32x4)
+SIMD_BINARY(i16x8_mul, u16x8, *)
+SIMD_BINARY(i32x4_mul, u32x4, *)
+SIMD_BINARY(i64x2_mul, u64x2, *)
+
+/* Rounding average: (a + b + 1) / 2 without overflowing the lane. */
+SIMD_INLINE wasm_rt_v128 i8x16_avgr_u(wasm_rt_v128 a, wasm_rt_v128 b) {
+#if WASM_RT_SIMD_NEON
+  return SIMD_V128(vrhaddq_u8((uint8x16_t)a, (uint8x16_t)b));
+#elif WASM_RT_SIMD_SSE2
+  return SIMD_V128(_mm_avg_epu8((__m128i)a, (__m128i)b));
+#else
+  wasm_rt_u8x16 x = SIMD_AS(u8x16, a), y = SIMD_AS(u8x16, b);
+  return SIMD_V128((x | y) - ((x ^ y) >> 1));
+#endif
+}
+
+SIMD_INLINE wasm_rt_v128 i16x8_avgr_u(wasm_rt_v128 a, wasm_rt_v128 b) {
+#if WASM_RT_SIMD_NEON
+  return SIMD_V128(vrhaddq_u16((uint16x8_t)a, (uint16x8_t)b));
+#elif WASM_RT_SIMD_SSE2
+  return SIMD_V128(_mm_avg_epu16((__m128i)a, (__m128i)b));
+#else
+  wasm_rt_u16x8 x = SIMD_AS(u16x8, a), y = SIMD_AS(u16x8, b);
+  return SIMD_V128((x | y) - ((x ^ y) >> 1));
+#endif
+}
+
+/* Saturating arithmetic. */
+#define SIMD_SATURATING(name, lanes, t, count, op, min, max, neon, sse) \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a, wasm_rt_v128 b) {       \
+    SIMD_SATURATING_BODY(lanes, t, count, op, min, max, neon, sse)      \
+  }
+
+/* The NEON vector types, for casts into the intrinsics. */
+#define SIMD_NEON_i8x16 int8x16_t
+#define SIMD_NEON_u8x16 uint8x16_t
+#define SIMD_NEON_i16x8 int16x8_t
+#define SIMD_NEON_u16x8 uint16x8_t
+#define SIMD_NEON_i32x4 int32x4_t
+#define SIMD_NEON_u32x4 uint32x4_t
+#define SIMD_NEON_f32x4 float32x4_t
+#define SIMD_NEON_f64x2 float64x2_t
+#define SIMD_NEON_AS(lanes, v) ((SIMD_NEON_##lanes)(v))
+
+#if WASM_RT_SIMD_NEON
+#define SIMD_SATURATING_BODY(lanes, t, count, op, min, max, neon, sse) \
+  return SIMD_V128(neon(SIMD_NEON_AS(lanes, a), SIMD_NEON_AS(lanes, b)));
+#elif WASM_RT_SIMD_SSE2
+#define SIMD_SATURATING_BODY(lanes, t, count, op, min, max, neon, sse) \
+  return SIMD_V128(sse((__m128i)a, (__m128i)b));
+#else
+#define SIMD_SATURATING_BODY(lanes, t, count, op, min, max, neon, sse) \
+  wasm_rt_##lanes x = SIMD_AS(lanes, a), y = SIMD_AS(lanes, b);        \
+  int i;                                                               \
+  for (i = 0; i < (count); ++i)                                        \
+    x[i] = (t)simd_saturate((int32_t)x[i] op(int32_t) y[i], min, max); \
+  return SIMD_V128(x);
+#endif
+
+SIMD_SATURATING(i8x16_add_sat_s, i8x16, int8_t, 16, +, INT8_MIN, INT8_MAX,
+                vqaddq_s8, _mm_adds_epi8)
+SIMD_SATURATING(i8x16_add_sat_u, u8x16, uint8_t, 16, +, 0, UINT8_MAX,
+                vqaddq_u8, _mm_adds_epu8)
+SIMD_SATURATING(i8x16_sub_sat_s, i8x16, int8_t, 16, -, INT8_MIN, INT8_MAX,
+                vqsubq_s8, _mm_subs_epi8)
+SIMD_SATURATING(i8x16_sub_sat_u, u8x16, uint8_t, 16, -, 0, UINT8_MAX,
+                vqsubq_u8, _mm_subs_epu8)
+SIMD_SATURATING(i16x8_add_sat_s, i16x8, int16_t, 8, +, INT16_MIN, INT16_MAX,
+                vqaddq_s16, _mm_adds_epi16)
+SIMD_SATURATING(i16x8_add_sat_u, u16x8, uint16_t, 8, +, 0, UINT16_MAX,
+                vqaddq_u16, _mm_adds_epu16)
+SIMD_SATURATING(i16x8_sub_sat_s, i16x8, int16_t, 8, -, INT16_MIN, INT16_MAX,
+                vqsubq_s16, _mm_subs_epi16)
+SIMD_SATURATING(i16x8_sub_sat_u, u16x8, uint16_t, 8, -, 0, UINT16_MAX,
+                vqsubq_u16, _mm_subs_epu16)
+
+/* Rounding Q15 multiplication, (a * b + 0x4000) >> 15, which only saturates
+ * for -32768 * -32768. */
+SIMD_INLINE wasm_rt_v128 i16x8_q15mulr_sat_s(wasm_rt_v128 a, wasm_rt_v128 b) {
+#if WASM_RT_SIMD_NEON
+  return SIMD_V128(vqrdmulhq_s16((int16x8_t)a, (int16x8_t)b));
+#elif WASM_RT_SIMD_SSE2 && defined(__SSSE3__)
+  /* pmulhrsw wraps that one case around to -32768, which no other inputs
+   * give; flip it to 32767. */
+  __m128i result = _mm_mulhrs_epi16((__m128i)a, (__m128i)b);
+  return SIMD_V128(_mm_xor_si128(
+      result, _mm_cmpeq_epi16(result, _mm_set1_epi16(INT16_MIN))));
+#else
+  wasm_rt_i16x8 x = SIMD_AS(i16x8, a), y = SIMD_AS(i16x8, b);
+  int i;
+  for (i = 0; i < 8; ++i) {
+    x[i] = (int16_t)simd_saturate((x[i] * y[i] + 0x4000) >> 15, INT16_MIN,
+                                  INT16_MAX);
+  }
+  return SIMD_V128(x);
+#endif
+}
+
+SIMD_INLINE wasm_rt_v128 i8x16_popcnt(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_NEON
+  return SIMD_V128(vcntq_u8((uint8x16_t)a));
+#else
+  /* Bit counting within each byte; the vector extensions lower this to a few
+   * shifts, masks and adds. */
+  wasm_rt_u8x16 x = SIMD_AS(u8x16, a);
+  x = x - ((x >> 1) & 0x55);
+  x = (x & 0x33) + ((x >> 2) & 0x33);
+  return SIMD_V128((x + (x >> 4)) & 0x0f);
+#endif
+}
+
+/* Sums of the products of adjacent signed 16-bit lanes. */
+SIMD_INLINE wasm_rt_v128 i32x4_dot_i16x8_s(wasm_rt_v128 a, wasm_rt_v128 b) {
+#if WASM_RT_SIMD_NEON
+  int16x8_t x = (int16x8_t)a, y = (int16x8_t)b;
+  int32x4_t low = vmull_s16(vget_low_s16(x), vget_low_s16(y));
+  int32x4_t high = vmull_s16(vget_high_s16(x), vget_high_s16(y));
+#if WASM_RT_SIMD_NEON64
+  return SIMD_V128(vpaddq_s32(low, high));
+#else
+  return SIMD_V128(
+      vcombine_s32(vpadd_s32(vget_low_s32(low), vget_high_s32(low)),
+                   vpadd_s32(vget_low_s32(high), vget_high_s32(high))));
+#endif
+#elif WASM_RT_SIMD_SSE2
+  return SIMD_V128(_mm_madd_epi16((__m128i)a, (__m128i)b));
+#else
+  wasm_rt_i16x8 x = SIMD_AS(i16x8, a), y = SIMD_AS(i16x8, b);
+  wasm_rt_u32x4 result;
+  int i;
+  for (i = 0; i < 4; ++i) {
+    result[i] = (uint32_t)((int32_t)x[2 * i] * y[2 * i]) +
+                (uint32_t)((int32_t)x[2 * i + 1] * y[2 * i + 1]);
+  }
+  return SIMD_V128(result);
+#endif
+}
+
+/* Widening and narrowing. */
+
+#define SIMD_EXTEND(name, to, from, count, offset)                   \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a) {                    \
+    wasm_rt_##from x = SIMD_AS(from, a);                             \
+    wasm_rt_##to result;                                             \
+    int i;                                                           \
+    for (i = 0; i < (count); ++i)                                    \
+      result[i] = x[i + (offset)];                                   \
+    return SIMD_V128(result);                                        \
+  }
+
+#if WASM_RT_SIMD_NEON
+#define SIMD_EXTEND_NEON(name, move, get, from)                      \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a) {                    \
+    return SIMD_V128(move(get(SIMD_NEON_AS(from, a))));              \
+  }
+SIMD_EXTEND_NEON(i16x8_extend_low_i8x16_s, vmovl_s8, vget_low_s8, i8x16)
+SIMD_EXTEND_NEON(i16x8_extend_high_i8x16_s, vmovl_s8, vget_high_s8, i8x16)
+SIMD_EXTEND_NEON(i16x8_extend_low_i8x16_u, vmovl_u8, vget_low_u8, u8x16)
+SIMD_EXTEND_NEON(i16x8_extend_high_i8x16_u, vmovl_u8, vget_high_u8, u8x16)
+SIMD_EXTEND_NEON(i32x4_extend_low_i16x8_s, vmovl_s16, vget_low_s16, i16x8)
+SIMD_EXTEND_NEON(i32x4_extend_high_i16x8_s, vmovl_s16, vget_high_s16, i16x8)
+SIMD_EXTEND_NEON(i32x4_extend_low_i16x8_u, vmovl_u16, vget_low_u16, u16x8)
+SIMD_EXTEND_NEON(i32x4_extend_high_i16x8_u, vmovl_u16, vget_high_u16, u16x8)
+SIMD_EXTEND_NEON(i64x2_extend_low_i32x4_s, vmovl_s32, vget_low_s32, i32x4)
+SIMD_EXTEND_NEON(i64x2_extend_high_i32x4_s, vmovl_s32, vget_high_s32, i32x4)
+SIMD_EXTEND_NEON(i64x2_extend_low_i32x4_u, vmovl_u32, vget_low_u32, u32x4)
+SIMD_EXTEND_NEON(i64x2_extend_high_i32x4_u, vmovl_u32, vget_high_u32, u32x4)
+#else
+SIMD_EXTEND(i16x8_extend_low_i8x16_s, i16x8, i8x16, 8, 0)
+SIMD_EXTEND(i16x8_extend_high_i8x16_s, i16x8, i8x16, 8, 8)
+SIMD_EXTEND(i16x8_extend_low_i8x16_u, u16x8, u8x16, 8, 0)
+SIMD_EXTEND(i16x8_extend_high_i8x16_u, u16x8, u8x16, 8, 8)
+SIMD_EXTEND(i32x4_extend_low_i16x8_s, i32x4, i16x8, 4, 0)
+SIMD_EXTEND(i32x4_extend_high_i16x8_s, i32x4, i16x8, 4, 4)
+SIMD_EXTEND(i32x4_extend_low_i16x8_u, u32x4, u16x8, 4, 0)
+SIMD_EXTEND(i32x4_extend_high_i16x8_u, u32x4, u16x8, 4, 4)
+SIMD_EXTEND(i64x2_extend_low_i32x4_s, i64x2, i32x4, 2, 0)
+SIMD_EXTEND(i64x2_extend_high_i32x4_s, i64x2, i32x4, 2, 2)
+SIMD_EXTEND(i64x2_extend_low_i32x4_u, u64x2, u32x4, 2, 0)
+SIMD_EXTEND(i64x2_extend_high_i32x4_u, u64x2, u32x4, 2, 2)
+#endif
+
+/* Products of the widened low or high halves of two vectors. */
+#if WASM_RT_SIMD_NEON
+#define SIMD_EXTMUL(name, from, extend, mul, neon_mul, neon_get)      \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a, wasm_rt_v128 b) {     \
+    return SIMD_V128(neon_mul(neon_get(SIMD_NEON_AS(from, a)),        \
+                              neon_get(SIMD_NEON_AS(from, b))));      \
+  }
+#else
+#define SIMD_EXTMUL(name, from, extend, mul, neon_mul, neon_get)      \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a, wasm_rt_v128 b) {     \
+    return mul(extend(a), extend(b));                                 \
+  }
+#endif
+
+SIMD_EXTMUL(i16x8_extmul_low_i8x16_s, i8x16, i16x8_extend_low_i8x16_s,
+            i16x8_mul, vmull_s8, vget_low_s8)
+SIMD_EXTMUL(i16x8_extmul_high_i8x16_s, i8x16, i16x8_extend_high_i8x16_s,
+            i16x8_mul, vmull_s8, vget_high_s8)
+SIMD_EXTMUL(i16x8_extmul_low_i8x16_u, u8x16, i16x8_extend_low_i8x16_u,
+            i16x8_mul, vmull_u8, vget_low_u8)
+SIMD_EXTMUL(i16x8_extmul_high_i8x16_u, u8x16, i16x8_extend_high_i8x16_u,
+            i16x8_mul, vmull_u8, vget_high_u8)
+SIMD_EXTMUL(i64x2_extmul_low_i32x4_s, i32x4, i64x2_extend_low_i32x4_s,
+            i64x2_mul, vmull_s32, vget_low_s32)
+SIMD_EXTMUL(i64x2_extmul_high_i32x4_s, i32x4, i64x2_extend_high_i32x4_s,
+            i64x2_mul, vmull_s32, vget_high_s32)
+SIMD_EXTMUL(i64x2_extmul_low_i32x4_u, u32x4, i64x2_extend_low_i32x4_u,
+            i64x2_mul, vmull_u32, vget_low_u32)
+SIMD_EXTMUL(i64x2_extmul_high_i32x4_u, u32x4, i64x2_extend_high_i32x4_u,
+            i64x2_mul, vmull_u32, vget_high_u32)
+
+#if WASM_RT_SIMD_SSE2
+/* pmullw and pmulhw give the low and high halves of the 32-bit products,
+ * which interleave into the low or high four of them. */
+#define SIMD_EXTMUL_SSE(name, mulhi, unpack)                          \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a, wasm_rt_v128 b) {     \
+    __m128i x = (__m128i)a, y = (__m128i)b;                           \
+    return SIMD_V128(unpack(_mm_mullo_epi16(x, y), mulhi(x, y)));     \
+  }
+SIMD_EXTMUL_SSE(i32x4_extmul_low_i16x8_s, _mm_mulhi_epi16, _mm_unpacklo_epi16)
+SIMD_EXTMUL_SSE(i32x4_extmul_high_i16x8_s, _mm_mulhi_epi16,
+                _mm_unpackhi_epi16)
+SIMD_EXTMUL_SSE(i32x4_extmul_low_i16x8_u, _mm_mulhi_epu16, _mm_unpacklo_epi16)
+SIMD_EXTMUL_SSE(i32x4_extmul_high_i16x8_u, _mm_mulhi_epu16,
+                _mm_unpackhi_epi16)
+#else
+SIMD_EXTMUL(i32x4_extmul_low_i16x8_s, i16x8, i32x4_extend_low_i16x8_s,
+            i32x4_mul, vmull_s16, vget_low_s16)
+SIMD_EXTMUL(i32x4_extmul_high_i16x8_s, i16x8, i32x4_extend_high_i16x8_s,
+            i32x4_mul, vmull_s16, vget_high_s16)
+SIMD_EXTMUL(i32x4_extmul_low_i16x8_u, u16x8, i32x4_extend_low_i16x8_u,
+            i32x4_mul, vmull_u16, vget_low_u16)
+SIMD_EXTMUL(i32x4_extmul_high_i16x8_u, u16x8, i32x4_extend_high_i16x8_u,
+            i32x4_mul, vmull_u16, vget_high_u16)
+#endif
+
+/* Sums of adjacent lanes, widened. */
+#define SIMD_PAIRWISE_SUMS(to, from, count, a)        \
+  wasm_rt_##from x = SIMD_AS(from, a);                \
+  wasm_rt_##to result;                                \
+  int i;                                              \
+  for (i = 0; i < (count); ++i)                       \
+    result[i] = x[2 * i] + x[2 * i + 1];              \
+  return SIMD_V128(result);
+
+SIMD_INLINE wasm_rt_v128 i16x8_extadd_pairwise_i8x16_s(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_NEON
+  return SIMD_V128(vpaddlq_s8((int8x16_t)a));
+#elif WASM_RT_SIMD_SSE2 && defined(__SSSE3__)
+  /* pmaddubsw multiplies unsigned bytes of its first operand by signed ones
+   * of its second, and adds pairs. */
+  return SIMD_V128(_mm_maddubs_epi16(_mm_set1_epi8(1), (__m128i)a));
+#else
+  SIMD_PAIRWISE_SUMS(i16x8, i8x16, 8, a)
+#endif
+}
+
+SIMD_INLINE wasm_rt_v128 i16x8_extadd_pairwise_i8x16_u(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_NEON
+  return SIMD_V128(vpaddlq_u8((uint8x16_t)a));
+#elif WASM_RT_SIMD_SSE2 && defined(__SSSE3__)
+  return SIMD_V128(_mm_maddubs_epi16((__m128i)a, _mm_set1_epi8(1)));
+#else
+  SIMD_PAIRWISE_SUMS(u16x8, u8x16, 8, a)
+#endif
+}
+
+SIMD_INLINE wasm_rt_v128 i32x4_extadd_pairwise_i16x8_s(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_NEON
+  return SIMD_V128(vpaddlq_s16((int16x8_t)a));
+#elif WASM_RT_SIMD_SSE2
+  return SIMD_V128(_mm_madd_epi16((__m128i)a, _mm_set1_epi16(1)));
+#else
+  SIMD_PAIRWISE_SUMS(i32x4, i16x8, 4, a)
+#endif
+}
+
+SIMD_INLINE wasm_rt_v128 i32x4_extadd_pairwise_i16x8_u(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_NEON
+  return SIMD_V128(vpaddlq_u16((uint16x8_t)a));
+#elif WASM_RT_SIMD_SSE2
+  /* pmaddwd only takes signed lanes: bias them by -32768, and add the
+   * 65536 that takes off each pair back on. */
+  __m128i biased = _mm_xor_si128((__m128i)a, _mm_set1_epi16(INT16_MIN));
+  return SIMD_V128(_mm_add_epi32(_mm_madd_epi16(biased, _mm_set1_epi16(1)),
+                                 _mm_set1_epi32(0x10000)));
+#else
+  SIMD_PAIRWISE_SUMS(u32x4, u16x8, 4, a)
+#endif
+}
+
+/* Narrowing saturates signed input lanes to the output lane type. */
+#define SIMD_NARROW(name, to, t, from, count, min, max)                   \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a, wasm_rt_v128 b) {        \
+    wasm_rt_##from x = SIMD_AS(from, a), y = SIMD_AS(from, b);           \
+    wasm_rt_##to result;                                                 \
+    int i;                                                               \
+    for (i = 0; i < (count); ++i) {                                      \
+      result[i] = (t)simd_saturate(x[i], min, max);                      \
+      result[i + (count)] = (t)simd_saturate(y[i], min, max);            \
+    }                                                                    \
+    return SIMD_V128(result);                                            \
+  }
+
+#if WASM_RT_SIMD_NEON
+SIMD_INLINE wasm_rt_v128 i8x16_narrow_i16x8_s(wasm_rt_v128 a, wasm_rt_v128 b) {
+  return SIMD_V128(vcombine_s8(vqmovn_s16((int16x8_t)a),
+                               vqmovn_s16((int16x8_t)b)));
+}
+SIMD_INLINE wasm_rt_v128 i8x16_narrow_i16x8_u(wasm_rt_v128 a, wasm_rt_v128 b) {
+  return SIMD_V128(vcombine_u8(vqmovun_s16((int16x8_t)a),
+                               vqmovun_s16((int16x8_t)b)));
+}
+SIMD_INLINE wasm_rt_v128 i16x8_narrow_i32x4_s(wasm_rt_v128 a, wasm_rt_v128 b) {
+  return SIMD_V128(vcombine_s16(vqmovn_s32((int32x4_t)a),
+                                vqmovn_s32((int32x4_t)b)));
+}
+SIMD_INLINE wasm_rt_v128 i16x8_narrow_i32x4_u(wasm_rt_v128 a, wasm_rt_v128 b) {
+  return SIMD_V128(vcombine_u16(vqmovun_s32((int32x4_t)a),
+                                vqmovun_s32((int32x4_t)b)));
+}
+#elif WASM_RT_SIMD_SSE2
+SIMD_INLINE wasm_rt_v128 i8x16_narrow_i16x8_s(wasm_rt_v128 a, wasm_rt_v128 b) {
+  return SIMD_V128(_mm_packs_epi16((__m128i)a, (__m128i)b));
+}
+SIMD_INLINE wasm_rt_v128 i8x16_narrow_i16x8_u(wasm_rt_v128 a, wasm_rt_v128 b) {
+  return SIMD_V128(_mm_packus_epi16((__m128i)a, (__m128i)b));
+}
+SIMD_INLINE wasm_rt_v128 i16x8_narrow_i32x4_s(wasm_rt_v128 a, wasm_rt_v128 b) {
+  return SIMD_V128(_mm_packs_epi32((__m128i)a, (__m128i)b));
+}
+#if defined(__SSE4_1__)
+SIMD_INLINE wasm_rt_v128 i16x8_narrow_i32x4_u(wasm_rt_v128 a, wasm_rt_v128 b) {
+  return SIMD_V128(_mm_packus_epi32((__m128i)a, (__m128i)b));
+}
+#else
+SIMD_NARROW(i16x8_narrow_i32x4_u, u16x8, uint16_t, i32x4, 4, 0, UINT16_MAX)
+#endif
+#else
+SIMD_NARROW(i8x16_narrow_i16x8_s, i8x16, int8_t, i16x8, 8, INT8_MIN, INT8_MAX)
+SIMD_NARROW(i8x16_narrow_i16x8_u, u8x16, uint8_t, i16x8, 8, 0, UINT8_MAX)
+SIMD_NARROW(i16x8_narrow_i32x4_s, i16x8, int16_t, i32x4, 4, INT16_MIN,
+            INT16_MAX)
+SIMD_NARROW(i16x8_narrow_i32x4_u, u16x8, uint16_t, i32x4, 4, 0, UINT16_MAX)
+#endif
+
+/* Floating point. */
+
+#define SIMD_FLOAT_OPS(prefix, lanes, sign_mask)             \
+  SIMD_BINARY(prefix##_add, lanes, +)                        \
+  SIMD_BINARY(prefix##_sub, lanes, -)                        \
+  SIMD_BINARY(prefix##_mul, lanes, *)                        \
+  SIMD_BINARY(prefix##_div, lanes, /)                        \
+  SIMD_BINARY(prefix##_eq, lanes, ==)                        \
+  SIMD_BINARY(prefix##_ne, lanes, !=)                        \
+  SIMD_BINARY(prefix##_lt, lanes, <)                         \
+  SIMD_BINARY(prefix##_gt, lanes, >)                         \
+  SIMD_BINARY(prefix##_le, lanes, <=)                        \
+  SIMD_BINARY(prefix##_ge, lanes, >=)                        \
+  /* pmin and pmax are plain compare-and-select. */          \
+  SIMD_INLINE wasm_rt_v128 prefix##_pmin(wasm_rt_v128 a,     \
+                                         wasm_rt_v128 b) {   \
+    return simd_select(                                      \
+        SIMD_V128(SIMD_AS(lanes, b) < SIMD_AS(lanes, a)), b, a); \
+  }                                                          \
+  SIMD_INLINE wasm_rt_v128 prefix##_pmax(wasm_rt_v128 a,     \
+                                         wasm_rt_v128 b) {   \
+    return simd_select(                                      \
+        SIMD_V128(SIMD_AS(lanes, a) < SIMD_AS(lanes, b)), b, a); \
+  }                                                          \
+  /* neg and abs only touch the sign bit, even of NaNs. */   \
+  SIMD_INLINE wasm_rt_v128 prefix##_neg(wasm_rt_v128 a) {    \
+    return a ^ (wasm_rt_v128)(sign_mask);                    \
+  }                                                          \
+  SIMD_INLINE wasm_rt_v128 prefix##_abs(wasm_rt_v128 a) {    \
+    return a & ~(wasm_rt_v128)(sign_mask);                   \
+  }
+
+SIMD_FLOAT_OPS(f32x4,
+               f32x4,
+               SIMD_V128(((wasm_rt_u32x4){0} + 0x80000000u)))
+SIMD_FLOAT_OPS(f64x2, f64x2, ((wasm_rt_u64x2){0} + 0x8000000000000000ull))
+
+/* Lane-wise application of a scalar function, for the fallbacks. */
+#define SIMD_MAP1(lanes, count, f, a)                 \
+  wasm_rt_##lanes x = SIMD_AS(lanes, a);              \
+  int i;                                              \
+  for (i = 0; i < (count); ++i)                       \
+    x[i] = f(x[i]);                                   \
+  return SIMD_V128(x);
+
+#define SIMD_MAP2(lanes, count, f, a, b)              \
+  wasm_rt_##lanes x = SIMD_AS(lanes, a), y = SIMD_AS(lanes, b); \
+  int i;                                              \
+  for (i = 0; i < (count); ++i)                       \
+    x[i] = f(x[i], y[i]);                             \
+  return SIMD_V128(x);
+
+SIMD_INLINE wasm_rt_v128 f32x4_min(wasm_rt_v128 a, wasm_rt_v128 b) {
+  SIMD_MAP2(f32x4, 4, simd_fminf, a, b)
+}
+
+SIMD_INLINE wasm_rt_v128 f32x4_max(wasm_rt_v128 a, wasm_rt_v128 b) {
+  SIMD_MAP2(f32x4, 4, simd_fmaxf, a, b)
+}
+
+SIMD_INLINE wasm_rt_v128 f64x2_min(wasm_rt_v128 a, wasm_rt_v128 b) {
+  SIMD_MAP2(f64x2, 2, simd_fmin, a, b)
+}
+
+SIMD_INLINE wasm_rt_v128 f64x2_max(wasm_rt_v128 a, wasm_rt_v128 b) {
+  SIMD_MAP2(f64x2, 2, simd_fmax, a, b)
+}
+
+SIMD_INLINE wasm_rt_v128 f32x4_sqrt(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_NEON64
+  return SIMD_V128(vsqrtq_f32((float32x4_t)a));
+#elif WASM_RT_SIMD_SSE2
+  return SIMD_V128(_mm_sqrt_ps((__m128)a));
+#else
+  SIMD_MAP1(f32x4, 4, sqrtf, a)
+#endif
+}
+
+SIMD_INLINE wasm_rt_v128 f64x2_sqrt(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_NEON64
+  return SIMD_V128(vsqrtq_f64((float64x2_t)a));
+#elif WASM_RT_SIMD_SSE2
+  return SIMD_V128(_mm_sqrt_pd((__m128d)a));
+#else
+  SIMD_MAP1(f64x2, 2, sqrt, a)
+#endif
+}
+
+#if WASM_RT_SIMD_NEON64
+#define SIMD_ROUND(name, lanes, count, f, neon, sse) \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a) {    \
+    return SIMD_V128(neon(SIMD_NEON_AS(lanes, a)));  \
+  }
+#elif WASM_RT_SIMD_SSE2 && defined(__SSE4_1__)
+#define SIMD_ROUND(name, lanes, count, f, neon, sse) \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a) {    \
+    return SIMD_V128(sse(a));                        \
+  }
+#else
+#define SIMD_ROUND(name, lanes, count, f, neon, sse) \
+  SIMD_INLINE wasm_rt_v128 name(wasm_rt_v128 a) {    \
+    SIMD_MAP1(lanes, count, f, a)                    \
+  }
+#endif
+
+#define SIMD_SSE_CEIL_PS(a) _mm_round_ps((__m128)(a), _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC)
+#define SIMD_SSE_FLOOR_PS(a) _mm_round_ps((__m128)(a), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)
+#define SIMD_SSE_TRUNC_PS(a) _mm_round_ps((__m128)(a), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)
+#define SIMD_SSE_NEAREST_PS(a) _mm_round_ps((__m128)(a), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+#define SIMD_SSE_CEIL_PD(a) _mm_round_pd((__m128d)(a), _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC)
+#define SIMD_SSE_FLOOR_PD(a) _mm_round_pd((__m128d)(a), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)
+#define SIMD_SSE_TRUNC_PD(a) _mm_round_pd((__m128d)(a), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)
+#define SIMD_SSE_NEAREST_PD(a) _mm_round_pd((__m128d)(a), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+
+SIMD_ROUND(f32x4_ceil, f32x4, 4, ceilf, vrndpq_f32, SIMD_SSE_CEIL_PS)
+SIMD_ROUND(f32x4_floor, f32x4, 4, floorf, vrndmq_f32, SIMD_SSE_FLOOR_PS)
+SIMD_ROUND(f32x4_trunc, f32x4, 4, truncf, vrndq_f32, SIMD_SSE_TRUNC_PS)
+SIMD_ROUND(f32x4_nearest, f32x4, 4, nearbyintf, vrndnq_f32, SIMD_SSE_NEAREST_PS)
+SIMD_ROUND(f64x2_ceil, f64x2, 2, ceil, vrndpq_f64, SIMD_SSE_CEIL_PD)
+SIMD_ROUND(f64x2_floor, f64x2, 2, floor, vrndmq_f64, SIMD_SSE_FLOOR_PD)
+SIMD_ROUND(f64x2_trunc, f64x2, 2, trunc, vrndq_f64, SIMD_SSE_TRUNC_PD)
+SIMD_ROUND(f64x2_nearest, f64x2, 2, nearbyint, vrndnq_f64, SIMD_SSE_NEAREST_PD)
+
+/* Conversions. */
+
+SIMD_INLINE wasm_rt_v128 f32x4_convert_i32x4_s(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_NEON
+  return SIMD_V128(vcvtq_f32_s32((int32x4_t)a));
+#elif WASM_RT_SIMD_SSE2
+  return SIMD_V128(_mm_cvtepi32_ps((__m128i)a));
+#else
+  wasm_rt_i32x4 x = SIMD_AS(i32x4, a);
+  return SIMD_V128(((wasm_rt_f32x4){(float)x[0], (float)x[1], (float)x[2],
+                                    (float)x[3]}));
+#endif
+}
+
+SIMD_INLINE wasm_rt_v128 f32x4_convert_i32x4_u(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_NEON
+  return SIMD_V128(vcvtq_f32_u32((uint32x4_t)a));
+#else
+  wasm_rt_u32x4 x = SIMD_AS(u32x4, a);
+  return SIMD_V128(((wasm_rt_f32x4){(float)x[0], (float)x[1], (float)x[2],
+                                    (float)x[3]}));
+#endif
+}
+
+/* NEON's conversions saturate and turn NaN into 0, exactly as wasm's do. */
+SIMD_INLINE wasm_rt_v128 i32x4_trunc_sat_f32x4_s(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_NEON
+  return SIMD_V128(vcvtq_s32_f32((float32x4_t)a));
+#else
+  wasm_rt_f32x4 x = SIMD_AS(f32x4, a);
+  wasm_rt_i32x4 result;
+  int i;
+  for (i = 0; i < 4; ++i)
+    result[i] = simd_trunc_sat_s32(x[i]);
+  return SIMD_V128(result);
+#endif
+}
+
+SIMD_INLINE wasm_rt_v128 i32x4_trunc_sat_f32x4_u(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_NEON
+  return SIMD_V128(vcvtq_u32_f32((float32x4_t)a));
+#else
+  wasm_rt_f32x4 x = SIMD_AS(f32x4, a);
+  wasm_rt_u32x4 result;
+  int i;
+  for (i = 0; i < 4; ++i)
+    result[i] = simd_trunc_sat_u32(x[i]);
+  return SIMD_V128(result);
+#endif
+}
+
+SIMD_INLINE wasm_rt_v128 i32x4_trunc_sat_f64x2_s_zero(wasm_rt_v128 a) {
+  wasm_rt_f64x2 x = SIMD_AS(f64x2, a);
+  return SIMD_V128(((wasm_rt_i32x4){simd_trunc_sat_s32(x[0]),
+                                    simd_trunc_sat_s32(x[1]), 0, 0}));
+}
+
+SIMD_INLINE wasm_rt_v128 i32x4_trunc_sat_f64x2_u_zero(wasm_rt_v128 a) {
+  wasm_rt_f64x2 x = SIMD_AS(f64x2, a);
+  return SIMD_V128(((wasm_rt_u32x4){simd_trunc_sat_u32(x[0]),
+                                    simd_trunc_sat_u32(x[1]), 0, 0}));
+}
+
+SIMD_INLINE wasm_rt_v128 f64x2_convert_low_i32x4_s(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_SSE2
+  return SIMD_V128(_mm_cvtepi32_pd((__m128i)a));
+#else
+  wasm_rt_i32x4 x = SIMD_AS(i32x4, a);
+  return SIMD_V128(((wasm_rt_f64x2){(double)x[0], (double)x[1]}));
+#endif
+}
+
+SIMD_INLINE wasm_rt_v128 f64x2_convert_low_i32x4_u(wasm_rt_v128 a) {
+  wasm_rt_u32x4 x = SIMD_AS(u32x4, a);
+  return SIMD_V128(((wasm_rt_f64x2){(double)x[0], (double)x[1]}));
+}
+
+SIMD_INLINE wasm_rt_v128 f32x4_demote_f64x2_zero(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_SSE2
+  return SIMD_V128(_mm_cvtpd_ps((__m128d)a));
+#else
+  wasm_rt_f64x2 x = SIMD_AS(f64x2, a);
+  return SIMD_V128(((wasm_rt_f32x4){(float)x[0], (float)x[1], 0, 0}));
+#endif
+}
+
+SIMD_INLINE wasm_rt_v128 f64x2_promote_low_f32x4(wasm_rt_v128 a) {
+#if WASM_RT_SIMD_SSE2
+  return SIMD_V128(_mm_cvtps_pd((__m128)a));
+#else
+  wasm_rt_f32x4 x = SIMD_AS(f32x4, a);
+  return SIMD_V128(((wasm_rt_f64x2){(double)x[0], (double)x[1]}));
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WASM_RT_SIMD_H_ */
@@ -35,6 +35,143 @@ extern "C" {
 #define WASM_RT_MAX_CALL_STACK_DEPTH 500
 #endif
 
+/** Whether stack exhaustion is detected with a guard page instead of by
+ * counting calls against `WASM_RT_MAX_CALL_STACK_DEPTH`. Generated functions
+ * then do no work on entry and exit. Wasm code must be entered through
+ * `wasm_rt_call_with_stack`, which runs it on a separate stack of
+ * `WASM_RT_STACK_SIZE` bytes per thread; overflowing it traps with
+ * `WASM_RT_TRAP_EXHAUSTION`. Needs a POSIX host, and must be defined the same
+ * way for the runtime and the generated c files. */
+#ifndef WASM_RT_STACK_GUARD_PAGE
+#define WASM_RT_STACK_GUARD_PAGE 0
+#endif
+
+#ifndef WASM_RT_STACK_SIZE
+#define WASM_RT_STACK_SIZE (8 * 1024 * 1024)
+#endif
+
+/** Whether the runtime provides fibers, on which a call into wasm can be
+ * suspended by a host function and resumed later; see `wasm_rt_fiber_new`.
+ * Needs a POSIX host with <ucontext.h>. */
+#ifndef WASM_RT_FIBERS
+#define WASM_RT_FIBERS 0
+#endif
+
+/** The stack size of each fiber. Like any stack, only the pages it touches
+ * use memory. */
+#ifndef WASM_RT_FIBER_STACK_SIZE
+#define WASM_RT_FIBER_STACK_SIZE (1024 * 1024)
+#endif
+
+/** Storage class for the runtime state that is kept per thread, such as the
+ * call stack depth, so that several threads can run wasm code at once. */
+#ifndef WASM_RT_THREAD_LOCAL
+#if defined(__cplusplus) && __cplusplus >= 201103L
+#define WASM_RT_THREAD_LOCAL thread_local
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define WASM_RT_THREAD_LOCAL _Thread_local
+#else
+#define WASM_RT_THREAD_LOCAL __thread
+#endif
+#endif
+
+/** Whether function type indices are fixed at build time. Normally
+ * `wasm_rt_register_func_type` numbers signatures in the order they are first
+ * registered, so generated code has to register its types when the module is
+ * initialized and look them up in every `call_indirect`. With this set, the
+ * index of a signature is its canonical ID instead: the 32-bit FNV-1a hash of
+ * the param count, the result count, and then each param and result type as a
+ * `wasm_rt_type_t` value, with the lowest bit set. Generated code can then
+ * emit the IDs as constants. Registering two different signatures with the
+ * same ID aborts. */
+#ifndef WASM_RT_STATIC_FUNC_TYPES
+#define WASM_RT_STATIC_FUNC_TYPES 0
+#endif
+
+/** Whether Table objects use a layout tuned for `call_indirect`. Function
+ * types and functions are kept in two separate arrays, so a cache line holds
+ * four times as many types as `wasm_rt_elem_t`s, and both are padded to a
+ * power-of-two length. Null and padding elements have function type 0, which
+ * no registered type has, and a function that traps. An indirect call is then
+ * a single branch on the index and type together, with no null check. Must be
+ * defined the same way for the runtime and the generated c files. */
+#ifndef WASM_RT_DISPATCH_TABLES
+#define WASM_RT_DISPATCH_TABLES 0
+#endif
+
+/** Whether generated functions count their calls and time themselves on
+ * entry and exit; see `wasm_rt_profile_enter`. Off by default, since it costs
+ * two clock reads per call. Must be defined the same way for the runtime and
+ * the generated c files. */
+#ifndef WASM_RT_PROFILE
+#define WASM_RT_PROFILE 0
+#endif
+
+/** Whether generated code burns fuel: one unit on every function entry and
+ * every loop iteration, trapping with `WASM_RT_TRAP_FUEL` when it runs out
+ * unless a handler refills it; see `wasm_rt_fuel`. This bounds how long a
+ * call into wasm can run, even one that never returns. Must be defined the
+ * same way for the runtime and the generated c files. */
+#ifndef WASM_RT_FUEL
+#define WASM_RT_FUEL 0
+#endif
+
+/** Whether linear memory is backed by anonymous `mmap` address space. The
+ * memory reserves up to its maximum size when it is allocated and grows in
+ * place by committing more of that range, so `data` does not move and new
+ * pages are not copied or cleared. Defaults to on for POSIX hosts; otherwise
+ * `calloc`/`realloc` are used. */
+#ifndef WASM_RT_USE_MMAP
+#if defined(__unix__) || defined(__APPLE__)
+#define WASM_RT_USE_MMAP 1
+#else
+#define WASM_RT_USE_MMAP 0
+#endif
+#endif
+
+/** Upper bound on the address space reserved for one memory, in pages. A
+ * memory that grows past its reservation is moved to a bigger one, which
+ * changes `data`. The default covers the full 4GiB on 64-bit hosts. On 32-bit
+ * hosts, where address space is scarce, it is 1MiB, so that a process can
+ * hold thousands of small instances; the few that grow bigger get moved. */
+#ifndef WASM_RT_MAX_RESERVED_PAGES
+#if UINTPTR_MAX > 0xffffffffu
+#define WASM_RT_MAX_RESERVED_PAGES 65536
+#else
+#define WASM_RT_MAX_RESERVED_PAGES 16
+#endif
+#endif
+
+/** Whether linear memory accesses are bounds checked by reserving the whole
+ * addressable range up front and trapping on the resulting SIGSEGV, instead of
+ * comparing every address against the memory size. This needs a 64-bit POSIX
+ * host, and must be defined the same way when building the runtime and the
+ * generated c files, for example:
+ *
+ * ```
+ *   cc -DWASM_RT_MEMCHECK_SIGNAL_HANDLER=1 my_module.c wasm-rt-impl.c
+ * ```
+ * */
+#ifndef WASM_RT_MEMCHECK_SIGNAL_HANDLER
+#define WASM_RT_MEMCHECK_SIGNAL_HANDLER 0
+#endif
+
+#if WASM_RT_MEMCHECK_SIGNAL_HANDLER
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "WASM_RT_MEMCHECK_SIGNAL_HANDLER requires a POSIX host"
+#endif
+#if UINTPTR_MAX <= 0xffffffffu
+#error "WASM_RT_MEMCHECK_SIGNAL_HANDLER requires a 64-bit host"
+#endif
+#if !WASM_RT_USE_MMAP
+#error "WASM_RT_MEMCHECK_SIGNAL_HANDLER requires WASM_RT_USE_MMAP"
+#endif
+#endif
+
+#if WASM_RT_STACK_GUARD_PAGE && !WASM_RT_USE_MMAP
+#error "WASM_RT_STACK_GUARD_PAGE requires WASM_RT_USE_MMAP"
+#endif
+
 /** Reason a trap occurred. Provide this to `wasm_rt_trap`. */
 typedef enum {
   WASM_RT_TRAP_NONE,         /** No error. */
@@ -45,6 +182,8 @@ typedef enum {
   WASM_RT_TRAP_UNREACHABLE,        /** Unreachable instruction executed. */
   WASM_RT_TRAP_CALL_INDIRECT,      /** Invalid call_indirect, for any reason. */
   WASM_RT_TRAP_EXHAUSTION,         /** Call stack exhausted. */
+  WASM_RT_TRAP_FUEL,               /** Ran out of fuel; see `wasm_rt_fuel`. */
+  WASM_RT_TRAP_EXIT,               /** The module called WASI proc_exit. */
 } wasm_rt_trap_t;
 
 /** Value types. Used to define function signatures. */
@@ -53,8 +192,15 @@ typedef enum {
   WASM_RT_I64,
   WASM_RT_F32,
   WASM_RT_F64,
+  WASM_RT_V128,
 } wasm_rt_type_t;
 
+/** A `v128` value, as it is stored and passed around. SIMD instructions view
+ * its 16 bytes as lanes of whichever type they operate on; they are defined
+ * in `wasm-rt-simd.h`. This is a GCC/Clang vector type, so it is kept in
+ * vector registers where the target has them. */
+typedef int64_t wasm_rt_v128 __attribute__((vector_size(16)));
+
 /** A function type for all `anyfunc` functions in a Table. All functions are
  * stored in this canonical form, but must be cast to their proper signature to
  * call. */
@@ -69,6 +215,14 @@ typedef struct {
   wasm_rt_anyfunc_t func;
 } wasm_rt_elem_t;
 
+#if WASM_RT_USE_MMAP
+/** A range of a Memory object mapped by `wasm_rt_memory_map_file`. */
+typedef struct {
+  uint32_t dest;
+  uint64_t length;
+} wasm_rt_file_map_t;
+#endif
+
 /** A Memory object. */
 typedef struct {
   /** The linear memory data, with a byte length of `size`. */
@@ -78,12 +232,50 @@ typedef struct {
   uint32_t pages, max_pages;
   /** The current size of the linear memory, in bytes. */
   uint32_t size;
+  /** The size of the address range reserved for `data`, in bytes. The memory
+   * can grow up to this size without `data` moving. */
+  uint64_t reserved_size;
+  /** The most pages this Memory object has had since it was allocated. */
+  uint32_t peak_pages;
+  /** How many times `wasm_rt_grow_memory` added pages, and how many times it
+   * failed to. */
+  uint64_t grow_count, failed_grow_count;
+  /** Time spent in `wasm_rt_grow_memory`, in nanoseconds. */
+  uint64_t grow_ns;
+#if WASM_RT_USE_MMAP
+  /** The ranges files are mapped over, which resetting or freeing the memory
+   * puts zeroed pages back in place of. */
+  wasm_rt_file_map_t* file_maps;
+  uint32_t file_map_count;
+#endif
 } wasm_rt_memory_t;
 
+/** A snapshot of a Memory object's usage; see `wasm_rt_memory_get_stats`. */
+typedef struct {
+  /** The current, maximum and peak page counts, as in `wasm_rt_memory_t`. */
+  uint32_t pages, max_pages, peak_pages;
+  /** Bytes of linear memory resident in host RAM; see
+   * `wasm_rt_memory_resident_size`. */
+  uint64_t resident_size;
+  /** Grow calls that succeeded and failed, and the time spent in them, as in
+   * `wasm_rt_memory_t`. */
+  uint64_t grow_count, failed_grow_count, grow_ns;
+} wasm_rt_memory_stats_t;
+
 /** A Table object. */
 typedef struct {
+#if WASM_RT_DISPATCH_TABLES
+  /** The function type of each element, `mask + 1` of them. */
+  uint32_t* func_types;
+  /** The function of each element, `mask + 1` of them. */
+  wasm_rt_anyfunc_t* funcs;
+  /** The padded element count minus one. `index & mask` is always a valid
+   * slot, and `index` is in the padded range iff `(index & ~mask) == 0`. */
+  uint32_t mask;
+#else
   /** The table element data, with an element count of `size`. */
   wasm_rt_elem_t* data;
+#endif
   /** The maximum element count of this Table object. If there is no maximum,
    * `max_size` is 0xffffffffu (i.e. UINT32_MAX). */
   uint32_t max_size;
@@ -97,10 +289,83 @@ typedef struct {
  *  This is typically called by the generated code, and not the embedder. */
 extern void wasm_rt_trap(wasm_rt_trap_t) __attribute__((noreturn));
 
+/** Call `func(arg)` on the calling thread's wasm stack, as required with
+ * `WASM_RT_STACK_GUARD_PAGE`. A trap inside `func` is passed on to the
+ * caller's `wasm_rt_impl_try` as if `func` had been called directly. Without
+ * `WASM_RT_STACK_GUARD_PAGE` this simply calls `func(arg)`.
+ *
+ *  ```
+ *    static void call_fib(void* arg) {
+ *      u32* n = arg;
+ *      *n = Z_fibZ_ii(&my_instance, *n);
+ *    }
+ *    ...
+ *    u32 n = 30;
+ *    wasm_rt_call_with_stack(call_fib, &n);
+ *  ``` */
+extern void wasm_rt_call_with_stack(void (*func)(void*), void* arg);
+
+#if WASM_RT_FIBERS
+/** A call running on its own stack, which can be suspended and resumed. */
+typedef struct wasm_rt_fiber_t wasm_rt_fiber_t;
+
+typedef enum {
+  WASM_RT_FIBER_READY,     /** Created, not started yet. */
+  WASM_RT_FIBER_RUNNING,   /** Running, or resuming another fiber. */
+  WASM_RT_FIBER_SUSPENDED, /** Suspended by `wasm_rt_fiber_suspend`. */
+  WASM_RT_FIBER_DONE,      /** Returned or trapped. */
+} wasm_rt_fiber_state_t;
+
+/** Create a fiber that will call `func(arg)` on a stack of its own of
+ * `WASM_RT_FIBER_STACK_SIZE` bytes, once resumed. Returns NULL if the stack
+ * cannot be allocated.
+ *
+ * A fiber has its own trap state: the call stack depth, try scopes and the
+ * `wasm_rt_impl_try` handler are switched along with the stack, so a trap
+ * always unwinds the fiber it happened on. A trap that nothing in the fiber
+ * catches ends it; see `wasm_rt_fiber_trap`. With `WASM_RT_STACK_GUARD_PAGE`
+ * the fiber's stack is the wasm stack while it runs, and overflowing it traps
+ * as usual. `wasm_rt_fuel` is not switched: it is a budget for the thread,
+ * to be set before each `wasm_rt_fiber_resume`. */
+extern wasm_rt_fiber_t* wasm_rt_fiber_new(void (*func)(void*), void* arg);
+
+/** Run `fiber` until it suspends or is done, and return which. A fiber may
+ * resume another, but only on the thread that created it.
+ *
+ *  ```
+ *    wasm_rt_fiber_t* fiber = wasm_rt_fiber_new(call_fib, &n);
+ *    while (wasm_rt_fiber_resume(fiber) != WASM_RT_FIBER_DONE) {
+ *      // Wait for whatever the fiber is waiting for.
+ *    }
+ *    if (wasm_rt_fiber_trap(fiber) == WASM_RT_TRAP_NONE)
+ *      printf("fib = %u\n", n);
+ *    wasm_rt_fiber_free(fiber);
+ *  ``` */
+extern wasm_rt_fiber_state_t wasm_rt_fiber_resume(wasm_rt_fiber_t* fiber);
+
+/** Suspend the calling fiber, returning from the `wasm_rt_fiber_resume` that
+ * ran it. Returns once the fiber is resumed. Typically called by a host
+ * function, in the middle of a call from wasm, to wait for I/O. */
+extern void wasm_rt_fiber_suspend(void);
+
+/** The fiber running on the calling thread, or NULL outside of fibers. */
+extern wasm_rt_fiber_t* wasm_rt_fiber_current(void);
+
+/** The trap that ended a fiber, or `WASM_RT_TRAP_NONE` if it returned. */
+extern wasm_rt_trap_t wasm_rt_fiber_trap(const wasm_rt_fiber_t* fiber);
+
+/** Free a fiber that is not running. A suspended fiber is dropped as it is,
+ * without unwinding its stack. */
+extern void wasm_rt_fiber_free(wasm_rt_fiber_t* fiber);
+#endif
+
 /** Register a function type with the given signature. The returned function
- * index is guaranteed to be the same for all calls with the same signature.
+ * index is guaranteed to be the same for all calls with the same signature,
+ * and is never 0. With `WASM_RT_STATIC_FUNC_TYPES` it is the signature's
+ * canonical ID rather than the small numbers shown below.
  * The following varargs must all be of type `wasm_rt_type_t`, first the
- * params` and then the `results`.
+ * params` and then the `results`. Registration takes constant time on
+ * average and may be done from several threads at once.
  *
  *  ```
  *    // Register (func (param i32 f32) (result i64)).
@@ -133,7 +398,8 @@ extern void wasm_rt_allocate_memory(wasm_rt_memory_t*,
 
 /** Grow a Memory object by `pages`, and return the previous page count. If
  * this new page count is greater than the maximum page count, the grow fails
- * and 0xffffffffu (UINT32_MAX) is returned instead.
+ * and 0xffffffffu (UINT32_MAX) is returned instead. With `WASM_RT_USE_MMAP`,
+ * `data` only moves if the memory outgrows its `reserved_size`.
  *
  *  ```
  *    wasm_rt_memory_t my_memory;
@@ -146,6 +412,172 @@ extern void wasm_rt_allocate_memory(wasm_rt_memory_t*,
  *  ``` */
 extern uint32_t wasm_rt_grow_memory(wasm_rt_memory_t*, uint32_t pages);
 
+/** The bulk memory instructions. Each checks its whole range once, traps with
+ * `WASM_RT_TRAP_OOB` before writing anything if part of it is out of bounds,
+ * and then does a single `memmove`, `memset` or `memcpy`.
+ *
+ * `memory.copy` copies `n` bytes from `src` to `dest`; the ranges may
+ * overlap. */
+extern void wasm_rt_memory_copy(wasm_rt_memory_t*,
+                                uint32_t dest,
+                                uint32_t src,
+                                uint32_t n);
+
+/** `memory.fill` sets `n` bytes at `dest` to the low byte of `value`. */
+extern void wasm_rt_memory_fill(wasm_rt_memory_t*,
+                                uint32_t dest,
+                                uint32_t value,
+                                uint32_t n);
+
+/** `memory.init` copies `n` bytes from offset `src` of a data segment of
+ * `segment_size` bytes to `dest`. A segment that has been dropped with
+ * `data.drop` is passed with a `segment_size` of 0, so that any non-empty
+ * copy from it traps.
+ *
+ *  ```
+ *    static const uint8_t data_segment_data_0[] = {...};
+ *    // data.drop 0
+ *    instance->data_segment_0_dropped = true;
+ *    // memory.init 0
+ *    wasm_rt_memory_init(&instance->memory, dest, data_segment_data_0,
+ *                        instance->data_segment_0_dropped ? 0 : 21, src, n);
+ *  ``` */
+extern void wasm_rt_memory_init(wasm_rt_memory_t*,
+                                uint32_t dest,
+                                const uint8_t* segment,
+                                uint32_t segment_size,
+                                uint32_t src,
+                                uint32_t n);
+
+#if WASM_RT_USE_MMAP
+/** A copy of a Memory object's contents, held in an anonymous file so it can
+ * be mapped copy-on-write into any number of new Memory objects. */
+typedef struct {
+  /** The file holding the image, `pages` pages long. */
+  int fd;
+  /** The page count and maximum page count of the captured Memory object. */
+  uint32_t pages, max_pages;
+} wasm_rt_memory_snapshot_t;
+
+/** Capture the current contents of a Memory object, typically right after
+ * the module's data segments have been copied into it.
+ *
+ *  ```
+ *    wasm_rt_memory_snapshot_t my_snapshot;
+ *    wasm_rt_snapshot_memory(&my_snapshot, &my_memory);
+ *  ``` */
+extern void wasm_rt_snapshot_memory(wasm_rt_memory_snapshot_t*,
+                                    const wasm_rt_memory_t*);
+
+/** Initialize a Memory object with the size, maximum and contents of a
+ * snapshot. The pages are mapped copy-on-write rather than copied, so this
+ * takes the same time for any size of memory, and pages that are only read
+ * stay shared with every other Memory object made from the snapshot.
+ *
+ *  ```
+ *    wasm_rt_memory_t my_memory;
+ *    wasm_rt_allocate_memory_from_snapshot(&my_memory, &my_snapshot);
+ *  ``` */
+extern void wasm_rt_allocate_memory_from_snapshot(
+    wasm_rt_memory_t*,
+    const wasm_rt_memory_snapshot_t*);
+
+/** Release a snapshot. Memory objects already made from it are unaffected. */
+extern void wasm_rt_free_memory_snapshot(wasm_rt_memory_snapshot_t*);
+#endif
+
+/** Release the linear memory of a Memory object. `data` must not be used
+ * afterwards. */
+extern void wasm_rt_free_memory(wasm_rt_memory_t*);
+
+/** Return how many bytes of a Memory object are resident in host RAM. With
+ * `WASM_RT_USE_MMAP`, pages are only faulted in when first touched, so this
+ * is usually much less than `size`; without it the whole memory is counted.
+ *
+ *  ```
+ *    wasm_rt_memory_t my_memory;
+ *    wasm_rt_allocate_memory(&my_memory, 256, 256);
+ *    // 16MiB committed, but nothing written yet.
+ *    wasm_rt_memory_resident_size(&my_memory);
+ *    => returns 0
+ *  ``` */
+extern uint64_t wasm_rt_memory_resident_size(const wasm_rt_memory_t*);
+
+/** Fill `stats` with the usage of a Memory object so far. The counts cover
+ * the object's whole life, across `wasm_rt_reset_memory`. This only reads
+ * the object, so a metrics thread may call it while the owning thread runs,
+ * at the risk of a torn read of a 64-bit count on 32-bit hosts.
+ *
+ *  ```
+ *    wasm_rt_memory_t my_memory;
+ *    wasm_rt_allocate_memory(&my_memory, 1, 4);
+ *    wasm_rt_grow_memory(&my_memory, 2);
+ *    wasm_rt_reset_memory(&my_memory, 1);
+ *    wasm_rt_memory_stats_t stats;
+ *    wasm_rt_memory_get_stats(&my_memory, &stats);
+ *    => stats.pages is 1, stats.peak_pages is 3 and stats.grow_count is 1
+ *  ``` */
+extern void wasm_rt_memory_get_stats(const wasm_rt_memory_t*,
+                                     wasm_rt_memory_stats_t* stats);
+
+/** Shrink a Memory object back to `pages` pages and restore the contents it
+ * was allocated with: zeroes, or for a memory allocated from a snapshot, the
+ * snapshot's. This is much cheaper than freeing and allocating it again.
+ * Returns how many bytes had to be discarded; with `WASM_RT_USE_MMAP` that is
+ * only the pages that were written to, and `data` does not move. That is
+ * exact on Linux; elsewhere pages that were only read are counted too, which
+ * makes the count an upper bound.
+ *
+ * A memory allocated from a snapshot keeps the snapshot only as long as it
+ * has not outgrown its `reserved_size`.
+ *
+ *  ```
+ *    wasm_rt_memory_t my_memory;
+ *    wasm_rt_allocate_memory(&my_memory, 1, 2);
+ *    wasm_rt_grow_memory(&my_memory, 1);
+ *    my_memory.data[0] = 1;
+ *    wasm_rt_reset_memory(&my_memory, 1);
+ *    => returns 4096 (one host page), and my_memory is one zeroed page again
+ *  ``` */
+extern uint64_t wasm_rt_reset_memory(wasm_rt_memory_t*, uint32_t pages);
+
+#if WASM_RT_USE_MMAP
+/** Map `size` bytes of the file `fd` from `offset` read-only over a Memory
+ * object at `dest`, so that wasm code reads the file's cached pages in place
+ * instead of a copy of them. `dest` must be a multiple of the wasm page size
+ * and `offset` of the host page size, and the file must hold `size` bytes
+ * from `offset`. The range is rounded up to whole host pages, which must lie
+ * inside the memory; past `size` the last page reads as the rest of the file,
+ * or zeroes after its end.
+ *
+ * Writes to the range fault, which traps with `WASM_RT_TRAP_OOB` under
+ * `WASM_RT_MEMCHECK_SIGNAL_HANDLER` and kills the process otherwise. The file
+ * stays mapped until `wasm_rt_memory_unmap_file`, `wasm_rt_reset_memory` or
+ * `wasm_rt_free_memory`, which leave zeroed pages in its place, even where a
+ * memory allocated from a snapshot had data. Should the memory outgrow its
+ * `reserved_size`, the range becomes a writable copy. Returns 0, or -1 with
+ * errno set: EINVAL if the range is misaligned or out of bounds.
+ *
+ *  ```
+ *    int fd = open("model.bin", O_RDONLY);
+ *    uint32_t dest = wasm_rt_grow_memory(&my_memory, 16) * 65536;
+ *    wasm_rt_memory_map_file(&my_memory, dest, fd, 0, 16 * 65536);
+ *    close(fd);
+ *  ``` */
+extern int wasm_rt_memory_map_file(wasm_rt_memory_t*,
+                                   uint32_t dest,
+                                   int fd,
+                                   uint64_t offset,
+                                   uint32_t size);
+
+/** Replace a range mapped by `wasm_rt_memory_map_file` with zeroed, writable
+ * pages again. Returns 0, or -1 with errno set: EINVAL if no file is mapped
+ * at exactly that range. */
+extern int wasm_rt_memory_unmap_file(wasm_rt_memory_t*,
+                                     uint32_t dest,
+                                     uint32_t size);
+#endif
+
 /** Initialize a Table object with an element count of `elements` and a maximum
  * page size of `max_elements`.
  *
@@ -158,8 +590,110 @@ extern void wasm_rt_allocate_table(wasm_rt_table_t*,
                                    uint32_t elements,
                                    uint32_t max_elements);
 
-/** Current call stack depth. */
-extern uint32_t wasm_rt_call_stack_depth;
+/** Set element `index` of a Table object, which must be less than `size`.
+ * This works with either table layout. A null `func` clears the element.
+ *
+ *  ```
+ *    uint32_t my_func_type = wasm_rt_register_func_type(0, 0);
+ *    wasm_rt_table_set(&my_table, 0, my_func_type, (wasm_rt_anyfunc_t)my_func);
+ *  ``` */
+extern void wasm_rt_table_set(wasm_rt_table_t*,
+                              uint32_t index,
+                              uint32_t func_type,
+                              wasm_rt_anyfunc_t func);
+
+/** Release the elements of a Table object. */
+extern void wasm_rt_free_table(wasm_rt_table_t*);
+
+/** Current call stack depth of the calling thread. */
+extern WASM_RT_THREAD_LOCAL uint32_t wasm_rt_call_stack_depth;
+
+#if WASM_RT_FUEL
+/** Fuel left to the calling thread, see `WASM_RT_FUEL`. Starts out at
+ * INT64_MAX, which is as good as unlimited; set it before a call into wasm
+ * to bound that call. Running code traps once this goes below zero, or first
+ * calls the thread's fuel handler if it has one.
+ *
+ *  ```
+ *    wasm_rt_fuel = 1000000;
+ *    wasm_rt_trap_t code = wasm_rt_impl_try();
+ *    if (code == WASM_RT_TRAP_FUEL) {
+ *      // The call ran for a million loop iterations and calls.
+ *    }
+ *  ``` */
+extern WASM_RT_THREAD_LOCAL int64_t wasm_rt_fuel;
+
+/** Called on the thread that ran out of fuel, in the middle of the wasm code
+ * that did. If it sets `wasm_rt_fuel` to zero or more, that code resumes
+ * where it was; otherwise it traps with `WASM_RT_TRAP_FUEL`. The handler may
+ * also trap itself, or call into wasm. */
+typedef void (*wasm_rt_fuel_handler_t)(void* user_data);
+
+/** Set the calling thread's fuel handler, or remove it with NULL. `user_data`
+ * is passed to each call of `handler`.
+ *
+ *  ```
+ *    void refill(void* user_data) {
+ *      if (--*(int*)user_data >= 0)
+ *        wasm_rt_fuel = 10000;
+ *    }
+ *
+ *    // Run in slices of 10000 units, at most 5 of them.
+ *    int slices = 5;
+ *    wasm_rt_fuel = 10000;
+ *    wasm_rt_set_fuel_handler(refill, &slices);
+ *  ``` */
+extern void wasm_rt_set_fuel_handler(wasm_rt_fuel_handler_t handler,
+                                     void* user_data);
+
+/** Called by generated code when `wasm_rt_fuel` goes below zero. */
+extern void wasm_rt_fuel_exhausted(void);
+#endif
+
+#if WASM_RT_PROFILE
+/** A function as the profiler sees it. Generated code keeps one of these per
+ * function in a static variable. */
+typedef struct wasm_rt_profile_func_t {
+  /** The module's `WASM_RT_MODULE_PREFIX` as a string, possibly empty. */
+  const char* module;
+  /** The function's name in the generated code: `f` and its index, or the
+   * name it is exported as. */
+  const char* name;
+  /** Assigned by the runtime on the first call; initialize to 0. */
+  uint32_t id;
+} wasm_rt_profile_func_t;
+
+/** Record a call to `func`, from `FUNC_PROLOGUE`. Calls are counted and timed
+ * per calling context, separately for each thread, using the cycle counter
+ * where one is readable from user space (`rdtsc`, `cntvct_el0`) and
+ * `clock_gettime` otherwise.
+ *
+ * The profile is written when the process exits, to the path prefix in the
+ * `WASM_RT_PROFILE_OUT` environment variable, or "wasm-rt-profile":
+ *
+ *  - `<prefix>.folded` has one line per calling context, its frames separated
+ *    by `;` and followed by its exclusive time in nanoseconds, as read by
+ *    flamegraph.pl and speedscope.
+ *  - `<prefix>.txt` has one line per function with its call count and its
+ *    inclusive and exclusive time in nanoseconds, most exclusive time first.
+ *
+ * A trap unwinds the calling context to where it was when the handler was
+ * set; the frames it unwinds keep their counts but not their time. */
+extern void wasm_rt_profile_enter(wasm_rt_profile_func_t* func);
+
+/** Record the return from the function last entered, from `FUNC_EPILOGUE`. */
+extern void wasm_rt_profile_exit(void);
+
+/** Write the profile of all threads so far to `<path_prefix>.folded` and
+ * `<path_prefix>.txt`, as described at `wasm_rt_profile_enter`. Returns 0, or
+ * -1 if either file could not be written. Functions running on other threads
+ * meanwhile may be left out or counted partially. */
+extern int wasm_rt_profile_dump(const char* path_prefix);
+
+/** The calling thread's current calling context, saved by the try macros and
+ * restored by a trap. */
+extern WASM_RT_THREAD_LOCAL void* wasm_rt_profile_context;
+#endif
 
 #ifdef __cplusplus
 }
@@ -1,8 +1,26 @@
 #! /bin/bash 
 
-wasm3 --func fib fib32.wasm 30
+# run_wasm <module.wasm> <function> [args...]
+# Run a function of a module from its cached native build when the image has
+# one for this exact module, and on wasm3 otherwise.
+run_wasm() {
+  local wasm=$1 func=$2
+  shift 2
+  local cached="aot-cache/$(sha256sum "$wasm" | cut -d' ' -f1).so"
+  if [ -f "$cached" ]; then
+    ./aot-run "$cached" "$func" "$@"
+    # 127: the build could not be loaded or lacks the function
+    [ $? -ne 127 ] && return
+  fi
+  wasm3 --func "$func" "$wasm" "$@"
+}
 
-wasm3 --func add as_demo.wasm 20 30
+run_wasm fib32.wasm fib 30
+
+run_wasm as_demo.wasm add 20 30
+
+# read test.txt through WASI, from the working directory aot-run preopens
+run_wasm as_demo.wasm readFile
 
 # run standalone binary with value 33 and store location 9(arbitrary)
 ./increment 33 9 # expected 34
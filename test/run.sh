@@ -0,0 +1,21 @@
+#! /bin/bash
+# Build and run the runtime tests. CFLAGS picks the target's SIMD backend,
+# such as -mfpu=neon on armv7hf, so run this with the image's flags.
+# wasi-sandbox is built twice, to check both ways wasi.c resolves paths.
+
+set -e
+cd "$(dirname "$0")"
+
+cc $CFLAGS -O2 -I../standalone -DWASM_RT_SIMD_SCALAR=1 \
+  -DSIMD_OPS=simd_scalar_ops -c simd-ops.c -o simd-scalar.o
+cc $CFLAGS -O2 -I../standalone -DSIMD_OPS=simd_native_ops \
+  -c simd-ops.c -o simd-native.o
+cc $CFLAGS -O2 -I../standalone -o simd simd.c simd-scalar.o simd-native.o -lm
+./simd
+
+for openat2 in 1 0; do
+  cc $CFLAGS -O2 -pthread -I../standalone -DWASI_USE_OPENAT2=$openat2 \
+    -o wasi-sandbox wasi-sandbox.c ../standalone/wasi.c \
+    ../standalone/wasm-rt-impl.c
+  ./wasi-sandbox
+done
@@ -0,0 +1,319 @@
+/* The table of simd.h, for one backend of wasm-rt-simd.h: test/run.sh
+ * compiles this once with -DWASM_RT_SIMD_SCALAR=1 -DSIMD_OPS=simd_scalar_ops
+ * and once with -DSIMD_OPS=simd_native_ops. */
+#include <string.h>
+#include "simd.h"
+#include "wasm-rt-simd.h"
+
+/* The scalar loads and stores that generated code defines, which the lane
+ * instructions are written with; here `mem` is the bytes of a vector. */
+static uint32_t i32_load8_u(const void *mem, uint32_t addr)
+{
+  uint8_t x;
+  memcpy(&x, (const char *)mem + addr, sizeof(x));
+  return x;
+}
+
+static uint32_t i32_load16_u(const void *mem, uint32_t addr)
+{
+  uint16_t x;
+  memcpy(&x, (const char *)mem + addr, sizeof(x));
+  return x;
+}
+
+static uint32_t i32_load(const void *mem, uint32_t addr)
+{
+  uint32_t x;
+  memcpy(&x, (const char *)mem + addr, sizeof(x));
+  return x;
+}
+
+static uint64_t i64_load(const void *mem, uint32_t addr)
+{
+  uint64_t x;
+  memcpy(&x, (const char *)mem + addr, sizeof(x));
+  return x;
+}
+
+static void i32_store8(void *mem, uint32_t addr, uint32_t x)
+{
+  uint8_t y = (uint8_t)x;
+  memcpy((char *)mem + addr, &y, sizeof(y));
+}
+
+static void i32_store16(void *mem, uint32_t addr, uint32_t x)
+{
+  uint16_t y = (uint16_t)x;
+  memcpy((char *)mem + addr, &y, sizeof(y));
+}
+
+static void i32_store(void *mem, uint32_t addr, uint32_t x)
+{
+  memcpy((char *)mem + addr, &x, sizeof(x));
+}
+
+static void i64_store(void *mem, uint32_t addr, uint64_t x)
+{
+  memcpy((char *)mem + addr, &x, sizeof(x));
+}
+
+#define SIMD_OPS_LIST(UNARY, BINARY, TERNARY, SHIFT, TEST, LANE) \
+  TEST(v128_any_true) \
+  TEST(i8x16_all_true) \
+  TEST(i16x8_all_true) \
+  TEST(i32x4_all_true) \
+  TEST(i64x2_all_true) \
+  TEST(i8x16_bitmask) \
+  TEST(i16x8_bitmask) \
+  TEST(i32x4_bitmask) \
+  TEST(i64x2_bitmask) \
+  UNARY(v128_not) \
+  UNARY(i8x16_neg) \
+  UNARY(i8x16_abs) \
+  UNARY(i16x8_neg) \
+  UNARY(i16x8_abs) \
+  UNARY(i32x4_neg) \
+  UNARY(i32x4_abs) \
+  UNARY(i64x2_neg) \
+  UNARY(i64x2_abs) \
+  UNARY(i8x16_popcnt) \
+  UNARY(i16x8_extend_low_i8x16_s) \
+  UNARY(i16x8_extend_high_i8x16_s) \
+  UNARY(i16x8_extend_low_i8x16_u) \
+  UNARY(i16x8_extend_high_i8x16_u) \
+  UNARY(i32x4_extend_low_i16x8_s) \
+  UNARY(i32x4_extend_high_i16x8_s) \
+  UNARY(i32x4_extend_low_i16x8_u) \
+  UNARY(i32x4_extend_high_i16x8_u) \
+  UNARY(i64x2_extend_low_i32x4_s) \
+  UNARY(i64x2_extend_high_i32x4_s) \
+  UNARY(i64x2_extend_low_i32x4_u) \
+  UNARY(i64x2_extend_high_i32x4_u) \
+  UNARY(i16x8_extadd_pairwise_i8x16_s) \
+  UNARY(i16x8_extadd_pairwise_i8x16_u) \
+  UNARY(i32x4_extadd_pairwise_i16x8_s) \
+  UNARY(i32x4_extadd_pairwise_i16x8_u) \
+  UNARY(f32x4_neg) \
+  UNARY(f32x4_abs) \
+  UNARY(f64x2_neg) \
+  UNARY(f64x2_abs) \
+  UNARY(f32x4_sqrt) \
+  UNARY(f64x2_sqrt) \
+  UNARY(f32x4_ceil) \
+  UNARY(f32x4_floor) \
+  UNARY(f32x4_trunc) \
+  UNARY(f32x4_nearest) \
+  UNARY(f64x2_ceil) \
+  UNARY(f64x2_floor) \
+  UNARY(f64x2_trunc) \
+  UNARY(f64x2_nearest) \
+  UNARY(f32x4_convert_i32x4_s) \
+  UNARY(f32x4_convert_i32x4_u) \
+  UNARY(i32x4_trunc_sat_f32x4_s) \
+  UNARY(i32x4_trunc_sat_f32x4_u) \
+  UNARY(i32x4_trunc_sat_f64x2_s_zero) \
+  UNARY(i32x4_trunc_sat_f64x2_u_zero) \
+  UNARY(f64x2_convert_low_i32x4_s) \
+  UNARY(f64x2_convert_low_i32x4_u) \
+  UNARY(f32x4_demote_f64x2_zero) \
+  UNARY(f64x2_promote_low_f32x4) \
+  BINARY(v128_and) \
+  BINARY(v128_andnot) \
+  BINARY(v128_or) \
+  BINARY(v128_xor) \
+  BINARY(i8x16_swizzle) \
+  BINARY(i8x16_add) \
+  BINARY(i8x16_sub) \
+  BINARY(i8x16_eq) \
+  BINARY(i8x16_ne) \
+  BINARY(i8x16_lt_s) \
+  BINARY(i8x16_gt_s) \
+  BINARY(i8x16_le_s) \
+  BINARY(i8x16_ge_s) \
+  BINARY(i16x8_add) \
+  BINARY(i16x8_sub) \
+  BINARY(i16x8_eq) \
+  BINARY(i16x8_ne) \
+  BINARY(i16x8_lt_s) \
+  BINARY(i16x8_gt_s) \
+  BINARY(i16x8_le_s) \
+  BINARY(i16x8_ge_s) \
+  BINARY(i32x4_add) \
+  BINARY(i32x4_sub) \
+  BINARY(i32x4_eq) \
+  BINARY(i32x4_ne) \
+  BINARY(i32x4_lt_s) \
+  BINARY(i32x4_gt_s) \
+  BINARY(i32x4_le_s) \
+  BINARY(i32x4_ge_s) \
+  BINARY(i64x2_add) \
+  BINARY(i64x2_sub) \
+  BINARY(i64x2_eq) \
+  BINARY(i64x2_ne) \
+  BINARY(i64x2_lt_s) \
+  BINARY(i64x2_gt_s) \
+  BINARY(i64x2_le_s) \
+  BINARY(i64x2_ge_s) \
+  BINARY(i8x16_lt_u) \
+  BINARY(i8x16_gt_u) \
+  BINARY(i8x16_le_u) \
+  BINARY(i8x16_ge_u) \
+  BINARY(i8x16_min_s) \
+  BINARY(i8x16_min_u) \
+  BINARY(i8x16_max_s) \
+  BINARY(i8x16_max_u) \
+  BINARY(i16x8_lt_u) \
+  BINARY(i16x8_gt_u) \
+  BINARY(i16x8_le_u) \
+  BINARY(i16x8_ge_u) \
+  BINARY(i16x8_min_s) \
+  BINARY(i16x8_min_u) \
+  BINARY(i16x8_max_s) \
+  BINARY(i16x8_max_u) \
+  BINARY(i32x4_lt_u) \
+  BINARY(i32x4_gt_u) \
+  BINARY(i32x4_le_u) \
+  BINARY(i32x4_ge_u) \
+  BINARY(i32x4_min_s) \
+  BINARY(i32x4_min_u) \
+  BINARY(i32x4_max_s) \
+  BINARY(i32x4_max_u) \
+  BINARY(i16x8_mul) \
+  BINARY(i32x4_mul) \
+  BINARY(i64x2_mul) \
+  BINARY(i8x16_avgr_u) \
+  BINARY(i16x8_avgr_u) \
+  BINARY(i8x16_add_sat_s) \
+  BINARY(i8x16_add_sat_u) \
+  BINARY(i8x16_sub_sat_s) \
+  BINARY(i8x16_sub_sat_u) \
+  BINARY(i16x8_add_sat_s) \
+  BINARY(i16x8_add_sat_u) \
+  BINARY(i16x8_sub_sat_s) \
+  BINARY(i16x8_sub_sat_u) \
+  BINARY(i16x8_q15mulr_sat_s) \
+  BINARY(i32x4_dot_i16x8_s) \
+  BINARY(i16x8_extmul_low_i8x16_s) \
+  BINARY(i16x8_extmul_high_i8x16_s) \
+  BINARY(i16x8_extmul_low_i8x16_u) \
+  BINARY(i16x8_extmul_high_i8x16_u) \
+  BINARY(i32x4_extmul_low_i16x8_s) \
+  BINARY(i32x4_extmul_high_i16x8_s) \
+  BINARY(i32x4_extmul_low_i16x8_u) \
+  BINARY(i32x4_extmul_high_i16x8_u) \
+  BINARY(i64x2_extmul_low_i32x4_s) \
+  BINARY(i64x2_extmul_high_i32x4_s) \
+  BINARY(i64x2_extmul_low_i32x4_u) \
+  BINARY(i64x2_extmul_high_i32x4_u) \
+  BINARY(i8x16_narrow_i16x8_s) \
+  BINARY(i8x16_narrow_i16x8_u) \
+  BINARY(i16x8_narrow_i32x4_s) \
+  BINARY(i16x8_narrow_i32x4_u) \
+  BINARY(f32x4_add) \
+  BINARY(f32x4_sub) \
+  BINARY(f32x4_mul) \
+  BINARY(f32x4_div) \
+  BINARY(f32x4_min) \
+  BINARY(f32x4_max) \
+  BINARY(f32x4_pmin) \
+  BINARY(f32x4_pmax) \
+  BINARY(f32x4_eq) \
+  BINARY(f32x4_ne) \
+  BINARY(f32x4_lt) \
+  BINARY(f32x4_gt) \
+  BINARY(f32x4_le) \
+  BINARY(f32x4_ge) \
+  BINARY(f64x2_add) \
+  BINARY(f64x2_sub) \
+  BINARY(f64x2_mul) \
+  BINARY(f64x2_div) \
+  BINARY(f64x2_min) \
+  BINARY(f64x2_max) \
+  BINARY(f64x2_pmin) \
+  BINARY(f64x2_pmax) \
+  BINARY(f64x2_eq) \
+  BINARY(f64x2_ne) \
+  BINARY(f64x2_lt) \
+  BINARY(f64x2_gt) \
+  BINARY(f64x2_le) \
+  BINARY(f64x2_ge) \
+  TERNARY(v128_bitselect) \
+  SHIFT(i8x16_shl) \
+  SHIFT(i8x16_shr_s) \
+  SHIFT(i8x16_shr_u) \
+  SHIFT(i16x8_shl) \
+  SHIFT(i16x8_shr_s) \
+  SHIFT(i16x8_shr_u) \
+  SHIFT(i32x4_shl) \
+  SHIFT(i32x4_shr_s) \
+  SHIFT(i32x4_shr_u) \
+  SHIFT(i64x2_shl) \
+  SHIFT(i64x2_shr_s) \
+  SHIFT(i64x2_shr_u) \
+  LANE(v128_load8_lane) \
+  LANE(v128_load16_lane) \
+  LANE(v128_load32_lane) \
+  LANE(v128_load64_lane) \
+  LANE(v128_store8_lane) \
+  LANE(v128_store16_lane) \
+  LANE(v128_store32_lane) \
+  LANE(v128_store64_lane)
+
+#define UNARY(name)                                          \
+  static wasm_rt_v128 op_##name(const wasm_rt_v128 *args)    \
+  {                                                          \
+    return name(args[0]);                                    \
+  }
+#define BINARY(name)                                         \
+  static wasm_rt_v128 op_##name(const wasm_rt_v128 *args)    \
+  {                                                          \
+    return name(args[0], args[1]);                           \
+  }
+#define TERNARY(name)                                        \
+  static wasm_rt_v128 op_##name(const wasm_rt_v128 *args)    \
+  {                                                          \
+    return name(args[0], args[1], args[2]);                  \
+  }
+#define SHIFT(name)                                          \
+  static wasm_rt_v128 op_##name(const wasm_rt_v128 *args)    \
+  {                                                          \
+    return name(args[0], (uint32_t)args[1][0]);              \
+  }
+#define TEST(name)                                           \
+  static wasm_rt_v128 op_##name(const wasm_rt_v128 *args)    \
+  {                                                          \
+    return (wasm_rt_v128){name(args[0]), 0};                 \
+  }
+/* Loads into lane 1 of the first operand from an offset into the bytes of the
+ * second, and stores lane 1 of the first over the bytes of the second. */
+#define LANE(name)                                           \
+  static wasm_rt_v128 op_##name(const wasm_rt_v128 *args)    \
+  {                                                          \
+    wasm_rt_v128 v = args[0], mem = args[1];                 \
+    LANE_##name                                              \
+  }
+#define LANE_LOAD(name) return name(&mem, 3, v, 1);
+#define LANE_STORE(name) name(&mem, 3, v, 1); return mem;
+#define LANE_v128_load8_lane LANE_LOAD(v128_load8_lane)
+#define LANE_v128_load16_lane LANE_LOAD(v128_load16_lane)
+#define LANE_v128_load32_lane LANE_LOAD(v128_load32_lane)
+#define LANE_v128_load64_lane LANE_LOAD(v128_load64_lane)
+#define LANE_v128_store8_lane LANE_STORE(v128_store8_lane)
+#define LANE_v128_store16_lane LANE_STORE(v128_store16_lane)
+#define LANE_v128_store32_lane LANE_STORE(v128_store32_lane)
+#define LANE_v128_store64_lane LANE_STORE(v128_store64_lane)
+
+SIMD_OPS_LIST(UNARY, BINARY, TERNARY, SHIFT, TEST, LANE)
+
+#undef UNARY
+#undef BINARY
+#undef TERNARY
+#undef SHIFT
+#undef TEST
+#undef LANE
+#define ENTRY(name) {#name, op_##name},
+
+const SimdOp SIMD_OPS[] = {
+  SIMD_OPS_LIST(ENTRY, ENTRY, ENTRY, ENTRY, ENTRY, ENTRY)
+  {NULL, NULL}
+};
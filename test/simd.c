@@ -0,0 +1,152 @@
+/* Check that the NEON or SSE paths of wasm-rt-simd.h agree with its scalar
+ * fallbacks on random and edge-case operands.
+ *
+ *   cc -O2 -I../standalone -DWASM_RT_SIMD_SCALAR=1 \
+ *      -DSIMD_OPS=simd_scalar_ops -c simd-ops.c -o simd-scalar.o
+ *   cc -O2 -I../standalone -DSIMD_OPS=simd_native_ops \
+ *      -c simd-ops.c -o simd-native.o
+ *   cc -O2 -I../standalone -o simd simd.c simd-scalar.o simd-native.o -lm
+ *   ./simd [rounds]
+ *
+ * Results must match bit for bit, except that float lanes which are NaN on
+ * both sides match, as wasm leaves NaN bits to the implementation. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simd.h"
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static uint64_t next_random(void)
+{
+  /* xorshift64* */
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 0x2545f4914f6cdd1dull;
+}
+
+/* Values around the lane limits and the float special cases, which random
+ * bits rarely hit. */
+static const uint16_t edge16[] = {0, 1, 0x7f, 0x80, 0xff, 0x7fff, 0x8000,
+                                  0x8001, 0xffff, 0x4000, 0xc000};
+static const float edge_f32[] = {0.0f, -0.0f, 0.5f, -0.5f, 1.5f, -2.5f,
+                                 2147483520.0f, 2147483648.0f, -2147483904.0f,
+                                 4294967040.0f, 4294967296.0f, 1e-40f,
+                                 INFINITY, -INFINITY, NAN};
+static const double edge_f64[] = {0.0, -0.0, 0.5, -0.5, 1.5, -2.5,
+                                  2147483647.5, 2147483648.0, -2147483649.0,
+                                  4294967295.5, 4294967296.0, 1e-310,
+                                  INFINITY, -INFINITY, NAN};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+/* One operand, drawn from a mix of random bits, small integers, integer lane
+ * limits and float values. */
+static wasm_rt_v128 random_operand(void)
+{
+  union {
+    wasm_rt_v128 v;
+    uint8_t u8[16];
+    uint16_t u16[8];
+    float f32[4];
+    double f64[2];
+  } x;
+  int i;
+  switch (next_random() % 5) {
+    case 0:
+      for (i = 0; i < 2; ++i)
+        x.v[i] = (int64_t)next_random();
+      break;
+    case 1:
+      for (i = 0; i < 16; ++i)
+        x.u8[i] = (uint8_t)(next_random() % 5 - 2);
+      break;
+    case 2:
+      for (i = 0; i < 8; ++i)
+        x.u16[i] = next_random() % 2 ? edge16[next_random() % COUNT(edge16)]
+                                     : (uint16_t)next_random();
+      break;
+    case 3:
+      for (i = 0; i < 4; ++i)
+        x.f32[i] = next_random() % 2
+                       ? edge_f32[next_random() % COUNT(edge_f32)]
+                       : (float)((int64_t)next_random() >> 20) / 4096.0f;
+      break;
+    default:
+      for (i = 0; i < 2; ++i)
+        x.f64[i] = next_random() % 2
+                       ? edge_f64[next_random() % COUNT(edge_f64)]
+                       : (double)((int64_t)next_random() >> 20) / 4096.0;
+      break;
+  }
+  return x.v;
+}
+
+/* Whether two results match: bit for bit, or but for float lanes that are NaN
+ * in both, for instructions named after a float lane type. */
+static int same_result(const char *name, wasm_rt_v128 a, wasm_rt_v128 b)
+{
+  int i;
+  if (memcmp(&a, &b, sizeof(a)) == 0)
+    return 1;
+  if (strncmp(name, "f32x4_", 6) == 0) {
+    float x[4], y[4];
+    memcpy(x, &a, sizeof(x));
+    memcpy(y, &b, sizeof(y));
+    for (i = 0; i < 4; ++i)
+      if (memcmp(&x[i], &y[i], sizeof(x[i])) != 0 &&
+          !(isnan(x[i]) && isnan(y[i])))
+        return 0;
+    return 1;
+  }
+  if (strncmp(name, "f64x2_", 6) == 0) {
+    double x[2], y[2];
+    memcpy(x, &a, sizeof(x));
+    memcpy(y, &b, sizeof(y));
+    for (i = 0; i < 2; ++i)
+      if (memcmp(&x[i], &y[i], sizeof(x[i])) != 0 &&
+          !(isnan(x[i]) && isnan(y[i])))
+        return 0;
+    return 1;
+  }
+  return 0;
+}
+
+static void print_v128(const char *label, wasm_rt_v128 v)
+{
+  fprintf(stderr, "  %-8s %016llx %016llx\n", label,
+          (unsigned long long)v[1], (unsigned long long)v[0]);
+}
+
+int main(int argc, char **argv)
+{
+  int rounds = argc > 1 ? atoi(argv[1]) : 100000;
+  int ops = 0, failures = 0;
+  int i, round;
+
+  for (i = 0; simd_scalar_ops[i].name; ++i) {
+    const SimdOp *scalar = &simd_scalar_ops[i], *native = &simd_native_ops[i];
+    ++ops;
+    for (round = 0; round < rounds; ++round) {
+      wasm_rt_v128 args[4] = {random_operand(), random_operand(),
+                              random_operand(), random_operand()};
+      wasm_rt_v128 expected = scalar->func(args);
+      wasm_rt_v128 actual = native->func(args);
+      if (!same_result(scalar->name, expected, actual)) {
+        fprintf(stderr, "%s differs:\n", scalar->name);
+        print_v128("a", args[0]);
+        print_v128("b", args[1]);
+        print_v128("c", args[2]);
+        print_v128("scalar", expected);
+        print_v128("native", actual);
+        ++failures;
+        break;
+      }
+    }
+  }
+  printf("%d of %d instructions match over %d rounds\n", ops - failures, ops,
+         rounds);
+  return failures != 0;
+}
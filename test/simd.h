@@ -0,0 +1,22 @@
+/* The SIMD instructions of wasm-rt-simd.h as a table, which simd-ops.c is
+ * compiled into once per backend, for simd.c to compare. */
+#ifndef SIMD_H_
+#define SIMD_H_
+
+#include "wasm-rt.h"
+
+/* One instruction applied to `args`: its vector operands in order, then a
+ * shift count in the low lane of the next one. Scalar results are returned
+ * in lane 0. */
+typedef struct {
+  const char *name;
+  wasm_rt_v128 (*func)(const wasm_rt_v128 *args);
+} SimdOp;
+
+/* Both tables end with a NULL name and list the same instructions in the same
+ * order: the first is built with WASM_RT_SIMD_SCALAR set, the second with the
+ * target's NEON or SSE. */
+extern const SimdOp simd_scalar_ops[];
+extern const SimdOp simd_native_ops[];
+
+#endif /* SIMD_H_ */
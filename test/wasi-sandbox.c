@@ -0,0 +1,164 @@
+/* Check that path_open keeps a module inside its preopened directory: paths
+ * with ".." components, absolute paths outside the preopen and symlinks that
+ * lead out are refused, while paths inside it open. Built once as wasi.c is by default
+ * and once with WASI_USE_OPENAT2=0, which always walks the path in user space:
+ *
+ *   cc -O2 -I../standalone -o wasi-sandbox wasi-sandbox.c \
+ *      ../standalone/wasi.c ../standalone/wasm-rt-impl.c
+ *   cc -O2 -I../standalone -DWASI_USE_OPENAT2=0 -o wasi-sandbox-walk \
+ *      wasi-sandbox.c ../standalone/wasi.c ../standalone/wasm-rt-impl.c
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "wasi.h"
+
+/* As in wasi.c. */
+#ifndef WASI_USE_OPENAT2
+#define WASI_USE_OPENAT2 1
+#endif
+
+#define RIGHT_FD_READ (1ull << 1)
+#define LOOKUP_SYMLINK_FOLLOW 1
+
+/* Where the path and the opened descriptor go in the module's memory. */
+#define PATH_ADDR 1024
+#define FD_ADDR 16
+
+static wasi_t wasi;
+static wasm_rt_memory_t memory;
+static uint32_t preopen_fd;
+static char guest_root[PATH_MAX];
+static int failures;
+
+static void write_file(const char *path, const char *contents)
+{
+  FILE *file = fopen(path, "w");
+  if (!file || fputs(contents, file) < 0 || fclose(file) != 0) {
+    perror(path);
+    exit(1);
+  }
+}
+
+/* path_open `path` for reading, following symlinks if `follow` is set. If it
+ * opens and `contents` is set, check that it reads that. Returns the WASI
+ * errno. */
+static uint32_t open_path(const char *path, int follow, const char *contents)
+{
+  uint32_t error, fd;
+  char buffer[64];
+  ssize_t length;
+  memcpy(memory.data + PATH_ADDR, path, strlen(path));
+  error = Z_wasi_snapshot_preview1Z_path_openZ_iiiiiijjii(
+      &wasi, preopen_fd, follow ? LOOKUP_SYMLINK_FOLLOW : 0, PATH_ADDR,
+      (uint32_t)strlen(path), 0, RIGHT_FD_READ, 0, 0, FD_ADDR);
+  if (error != 0)
+    return error;
+  memcpy(&fd, memory.data + FD_ADDR, sizeof(fd));
+  length = read(wasi.fds[fd].host_fd, buffer, sizeof(buffer) - 1);
+  buffer[length > 0 ? length : 0] = '\0';
+  if (contents && strcmp(buffer, contents) != 0) {
+    fprintf(stderr, "%s: read \"%s\", not \"%s\"\n", path, buffer, contents);
+    ++failures;
+  }
+  Z_wasi_snapshot_preview1Z_fd_closeZ_ii(&wasi, fd);
+  return 0;
+}
+
+static void expect_open(const char *path, int follow)
+{
+  uint32_t error = open_path(path, follow, "inside");
+  if (error != 0) {
+    fprintf(stderr, "%s: refused with %u, but is inside\n", path, error);
+    ++failures;
+  }
+}
+
+static void expect_refused(const char *path, int follow)
+{
+  if (open_path(path, follow, NULL) == 0) {
+    fprintf(stderr, "%s: opened, but leads outside\n", path);
+    ++failures;
+  }
+}
+
+int main(void)
+{
+  char dir[] = "/tmp/wasi-sandbox-XXXXXX";
+  char path[PATH_MAX + 64];
+  const char *mode = "openat2";
+  int follow;
+
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  /* dir/root is preopened; dir/outside holds what must stay out of reach. */
+  snprintf(guest_root, sizeof(guest_root), "%s/root", dir);
+  snprintf(path, sizeof(path), "%s/outside", dir);
+  if (mkdir(guest_root, 0700) != 0 || mkdir(path, 0700) != 0 ||
+      chdir(guest_root) != 0 || mkdir("sub", 0700) != 0) {
+    perror(dir);
+    return 1;
+  }
+  write_file("file", "inside");
+  write_file("sub/file", "inside");
+  write_file("../outside/file", "outside");
+  if (symlink("../outside", "dir-out") != 0 ||
+      symlink("../outside/file", "file-out") != 0 ||
+      symlink(path, "absolute-out") != 0 ||
+      symlink("/etc/passwd", "passwd") != 0) {
+    perror("symlink");
+    return 1;
+  }
+
+  wasm_rt_allocate_memory(&memory, 1, 1);
+  if (wasi_init(&wasi, &memory, 0, NULL, NULL) < 0 ||
+      (int)(preopen_fd = (uint32_t)wasi_preopen(&wasi, guest_root,
+                                                 guest_root)) < 0) {
+    perror("wasi");
+    return 1;
+  }
+
+#if !WASI_USE_OPENAT2 || !defined(SYS_openat2)
+  mode = "walk";
+#else
+  if (syscall(SYS_openat2, AT_FDCWD, ".", NULL, 0) < 0 &&
+      (errno == ENOSYS || errno == EPERM))
+    mode = "walk, as openat2 is unavailable";
+#endif
+
+  for (follow = 0; follow <= 1; ++follow) {
+    expect_open("file", follow);
+    expect_open("sub/file", follow);
+    snprintf(path, sizeof(path), "%s/sub/file", guest_root);
+    expect_open(path, follow);
+
+    expect_refused("../outside/file", follow);
+    expect_refused("sub/../../outside/file", follow);
+    expect_refused("..", follow);
+    expect_refused("sub/../file", follow);
+    expect_refused("/etc/passwd", follow);
+    snprintf(path, sizeof(path), "%s/outside/file", dir);
+    expect_refused(path, follow);
+    expect_refused("dir-out/file", follow);
+    expect_refused("file-out", follow);
+    expect_refused("absolute-out/file", follow);
+    expect_refused("passwd", follow);
+    expect_refused("sub/../dir-out/file", follow);
+  }
+
+  wasi_free(&wasi);
+  snprintf(path, sizeof(path), "rm -rf %s", dir);
+  if (system(path) != 0)
+    fprintf(stderr, "could not remove %s\n", dir);
+  printf("wasi-sandbox (%s): %s\n", mode, failures ? "FAILED" : "ok");
+  return failures != 0;
+}